@@ -0,0 +1,179 @@
+/* Helpers shared by the benchmark clients */
+#define _POSIX_C_SOURCE 200112L
+
+#include "bench.h"
+#include <X11/Xatom.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/select.h>
+#include <time.h>
+
+static int compare(void const *a, void const *b);
+static int xerror(Display *d, XErrorEvent *ee);
+
+Display *dpy;
+Window root;
+static char const *progname = "bench";
+static bool wm_running;
+
+void
+bench_barrier(void)
+{
+	XEvent ev;
+	Window probe;
+
+	/* the window manager handles events in order: once it has mapped a
+	 * (floating) probe window, it has handled everything sent before */
+	probe = bench_create_window(true);
+	XMapWindow(dpy, probe);
+	do {
+		bench_next_event(&ev);
+	} while (ev.type != MapNotify || ev.xmap.window != probe);
+	XDestroyWindow(dpy, probe);
+	XSync(dpy, False);
+}
+
+Window
+bench_create_window(bool dialog)
+{
+	Window win;
+	Atom type, dialogtype;
+
+	win = XCreateSimpleWindow(dpy, root, 0, 0, 100, 100, 0, 0, 0);
+	XSelectInput(dpy, win, StructureNotifyMask | FocusChangeMask);
+	if (dialog) {
+		type = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
+		dialogtype = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG",
+		                         False);
+		XChangeProperty(dpy, win, type, XA_ATOM, 32, PropModeReplace,
+		                (char unsigned *) &dialogtype, 1);
+	}
+	return win;
+}
+
+void
+bench_die(char const *msg)
+{
+	fprintf(stderr, "%s: %s\n", progname, msg);
+	exit(EXIT_FAILURE);
+}
+
+void
+bench_next_event(XEvent *ev)
+{
+	fd_set fds;
+	struct timeval tv;
+	uint64_t t, deadline = bench_now() + (uint64_t) TIMEOUT * 1000000000;
+	int fd = ConnectionNumber(dpy);
+
+	while (XPending(dpy) == 0) {
+		t = bench_now();
+		if (t >= deadline)
+			bench_die("timeout waiting for the window manager");
+		tv.tv_sec = (time_t) ((deadline - t) / 1000000000);
+		tv.tv_usec = (suseconds_t) ((deadline - t) % 1000000000 / 1000);
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		if (select(fd + 1, &fds, NULL, NULL, &tv) < 0 && errno != EINTR)
+			bench_die("select() failed");
+	}
+	XNextEvent(dpy, ev);
+}
+
+uint64_t
+bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+void
+bench_open_display(char const *name)
+{
+	struct timespec ts = { 0, 100000000 };
+	uint64_t deadline = bench_now() + (uint64_t) TIMEOUT * 1000000000;
+
+	progname = name;
+	while ((dpy = XOpenDisplay(NULL)) == NULL) {
+		if (bench_now() >= deadline)
+			bench_die("could not open display");
+		nanosleep(&ts, NULL);
+	}
+	root = DefaultRootWindow(dpy);
+}
+
+void
+bench_report_latency(size_t clients, char const *metric,
+                     uint64_t *lat, size_t n)
+{
+	qsort(lat, n, sizeof(uint64_t), compare);
+	printf("{\"clients\":%zu,\"metric\":\"%s\",\"unit\":\"us\","
+	       "\"p50\":%.1f,\"p99\":%.1f,\"max\":%.1f}\n",
+	       clients, metric, (double) lat[n / 2] / 1000.0,
+	       (double) lat[(n * 99) / 100] / 1000.0,
+	       (double) lat[n - 1] / 1000.0);
+	fflush(stdout);
+}
+
+void
+bench_wait_for_wm(void)
+{
+	struct timespec ts = { 0, 100000000 };
+	uint64_t deadline = bench_now() + (uint64_t) TIMEOUT * 1000000000;
+	XErrorHandler old;
+
+	/* a window manager is running if redirecting the root fails */
+	old = XSetErrorHandler(xerror);
+	for (;;) {
+		wm_running = false;
+		XSelectInput(dpy, root, SubstructureRedirectMask);
+		XSync(dpy, False);
+		if (wm_running)
+			break;
+		XSelectInput(dpy, root, NoEventMask);
+		XSync(dpy, False);
+		if (bench_now() >= deadline)
+			bench_die("no window manager running");
+		nanosleep(&ts, NULL);
+	}
+	XSetErrorHandler(old);
+}
+
+void
+bench_wait_windows(Window *wins, size_t n, int type)
+{
+	size_t i, seen = 0;
+	XEvent ev;
+
+	while (seen < n) {
+		bench_next_event(&ev);
+		if (ev.type != type)
+			continue;
+		for (i = 0; i < n; ++i) {
+			if (wins[i] == ev.xany.window) {
+				++seen;
+				break;
+			}
+		}
+	}
+}
+
+static int
+compare(void const *a, void const *b)
+{
+	uint64_t x = *(uint64_t const *) a, y = *(uint64_t const *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int
+xerror(Display *d, XErrorEvent *ee)
+{
+	(void) d;
+
+	if (ee->error_code == BadAccess)
+		wm_running = true;
+	return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef _KARUIWM_BENCH_H
+#define _KARUIWM_BENCH_H
+
+#include <X11/Xlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TIMEOUT 60 /* seconds without a reply from the window manager */
+
+void bench_barrier(void);
+Window bench_create_window(bool dialog);
+void bench_die(char const *msg);
+void bench_next_event(XEvent *ev);
+uint64_t bench_now(void);
+void bench_open_display(char const *name);
+void bench_report_latency(size_t clients, char const *metric,
+                          uint64_t *lat, size_t n);
+void bench_wait_for_wm(void);
+void bench_wait_windows(Window *wins, size_t n, int type);
+
+extern Display *dpy;
+extern Window root;
+
+#endif /* ndef _KARUIWM_BENCH_H */
@@ -0,0 +1,206 @@
+/* Keystroke-to-effect latency harness for the karuiwm benchmark suite, see
+ * run.sh.
+ *
+ *   keylat [-r ROUNDS] [CLIENTS ...]
+ *
+ * For each client count (2, 10 and 100 by default), the key bindings from
+ * Xresources are pressed through the XTest extension, and the time until the
+ * resulting focus change, ConfigureNotify or (un)mapping is observed on the
+ * affected windows. Results are written to stdout as one JSON object per line.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "bench.h"
+#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROUNDS 100 /* key presses per binding and client count */
+#define SETTLE 20  /* milliseconds without events before a key press */
+
+static bool is_client(Window win);
+static void map_clients(size_t n);
+static uint64_t press(KeySym key);
+static void run(size_t n);
+static void settle(void);
+static uint64_t wait_configure(void);
+static uint64_t wait_focus(void);
+
+static Window *wins;
+static size_t nwins, rounds = ROUNDS;
+static KeyCode modifier;
+
+static bool
+is_client(Window win)
+{
+	size_t i;
+
+	for (i = 0; i < nwins; ++i)
+		if (wins[i] == win)
+			return true;
+	return false;
+}
+
+static void
+map_clients(size_t n)
+{
+	XEvent ev;
+
+	wins = calloc(n, sizeof(Window));
+	if (wins == NULL)
+		bench_die("out of memory");
+	for (nwins = 0; nwins < n; ++nwins) {
+		wins[nwins] = bench_create_window(false);
+		XStoreName(dpy, wins[nwins], "keylat");
+		XMapWindow(dpy, wins[nwins]);
+		do {
+			bench_next_event(&ev);
+		} while (ev.type != MapNotify || ev.xmap.window != wins[nwins]);
+	}
+}
+
+static uint64_t
+press(KeySym key)
+{
+	uint64_t t;
+	KeyCode code = XKeysymToKeycode(dpy, key);
+
+	settle();
+	t = bench_now();
+	XTestFakeKeyEvent(dpy, modifier, True, CurrentTime);
+	XTestFakeKeyEvent(dpy, code, True, CurrentTime);
+	XTestFakeKeyEvent(dpy, code, False, CurrentTime);
+	XTestFakeKeyEvent(dpy, modifier, False, CurrentTime);
+	XFlush(dpy);
+	return t;
+}
+
+static void
+run(size_t n)
+{
+	size_t r, i;
+	uint64_t *stepclient, *zoom, *setmfact, *stepdesktop, t;
+
+	stepclient = calloc(rounds, sizeof(uint64_t));
+	zoom = calloc(rounds, sizeof(uint64_t));
+	setmfact = calloc(rounds, sizeof(uint64_t));
+	stepdesktop = calloc(2 * rounds, sizeof(uint64_t));
+	if (stepclient == NULL || zoom == NULL || setmfact == NULL
+	|| stepdesktop == NULL)
+		bench_die("out of memory");
+	map_clients(n);
+
+	for (r = 0; r < rounds; ++r) {
+		t = press(XK_j);
+		stepclient[r] = wait_focus() - t;
+
+		t = press(XK_Return);
+		zoom[r] = wait_configure() - t;
+
+		t = press(r % 2 == 0 ? XK_l : XK_h);
+		setmfact[r] = wait_configure() - t;
+
+		t = press(XK_Right);
+		bench_wait_windows(wins, nwins, UnmapNotify);
+		stepdesktop[2 * r] = bench_now() - t;
+		t = press(XK_Left);
+		bench_wait_windows(wins, nwins, MapNotify);
+		stepdesktop[2 * r + 1] = bench_now() - t;
+	}
+	bench_report_latency(n, "key_stepclient", stepclient, rounds);
+	bench_report_latency(n, "key_zoom", zoom, rounds);
+	bench_report_latency(n, "key_setmfact", setmfact, rounds);
+	bench_report_latency(n, "key_stepdesktop", stepdesktop, 2 * rounds);
+
+	for (i = 0; i < nwins; ++i)
+		XDestroyWindow(dpy, wins[i]);
+	XSync(dpy, False);
+	free(wins);
+	free(stepclient);
+	free(zoom);
+	free(setmfact);
+	free(stepdesktop);
+}
+
+static void
+settle(void)
+{
+	XEvent ev;
+	uint64_t idle;
+	struct timespec ts = { 0, 1000000 };
+
+	/* let the window manager finish the previous action, so its trailing
+	 * events are not taken for the effect of the next key press */
+	XSync(dpy, False);
+	idle = bench_now() + (uint64_t) SETTLE * 1000000;
+	while (bench_now() < idle) {
+		if (XPending(dpy) > 0) {
+			XNextEvent(dpy, &ev);
+			idle = bench_now() + (uint64_t) SETTLE * 1000000;
+		} else {
+			nanosleep(&ts, NULL);
+		}
+	}
+}
+
+static uint64_t
+wait_configure(void)
+{
+	XEvent ev;
+
+	do {
+		bench_next_event(&ev);
+	} while (ev.type != ConfigureNotify || ev.xany.send_event
+	      || !is_client(ev.xconfigure.window));
+	return bench_now();
+}
+
+static uint64_t
+wait_focus(void)
+{
+	XEvent ev;
+	Window focus;
+	int revert;
+
+	XGetInputFocus(dpy, &focus, &revert);
+	do {
+		bench_next_event(&ev);
+	} while (ev.type != FocusIn || ev.xfocus.window == focus
+	      || !is_client(ev.xfocus.window));
+	return bench_now();
+}
+
+int
+main(int argc, char **argv)
+{
+	int opt, i;
+	int major, minor, event, error;
+
+	while ((opt = getopt(argc, argv, "r:")) != -1) {
+		switch (opt) {
+		case 'r': rounds = (size_t) strtoul(optarg, NULL, 10); break;
+		default: bench_die("usage: keylat [-r ROUNDS] [CLIENTS ...]");
+		}
+	}
+	if (rounds == 0)
+		bench_die("usage: keylat [-r ROUNDS] [CLIENTS ...]");
+	bench_open_display("keylat");
+	if (!XTestQueryExtension(dpy, &event, &error, &major, &minor))
+		bench_die("XTest extension not available");
+	modifier = XKeysymToKeycode(dpy, XK_Super_L);
+	bench_wait_for_wm();
+
+	if (optind == argc) {
+		run(2);
+		run(10);
+		run(100);
+	} else {
+		for (i = optind; i < argc; ++i)
+			run((size_t) strtoul(argv[i], NULL, 10));
+	}
+
+	XCloseDisplay(dpy);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/* Micro-benchmarks of the core model, linked against the stub X library
+ * (xstub.c) instead of libX11, so no X server is needed:
+ *
+ *   model [-p] [-n CLIENTS] [-d DESKTOPS] [-r ROUNDS]
+ *
+ * With -p, hidden desktops are parked off-screen instead of unmapped.
+ * Results are written to stdout as one JSON object per line, with the time and
+ * the number of X requests per operation.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "xstub.h"
+#include "karuiwm.h"
+#include "client.h"
+#include "config.h"
+#include "desktop.h"
+#include "focus.h"
+#include "monitor.h"
+#include "session.h"
+#include "stats.h"
+#include "util.h"
+#include "workspace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define FIRST_WINDOW 0x400000
+
+static void bench_arrange(void);
+static void bench_attach(void);
+static void bench_focus(void);
+static void bench_free_slot(void);
+static void bench_locate(void);
+static void bench_new(void);
+static void bench_step_desktop(void);
+static void report(char const *metric, size_t nops);
+static void start(void);
+
+static size_t nclients = 100000, ndesktops = 1000, rounds = 100;
+static struct client **clients;
+static uint64_t start_ns;
+static long unsigned start_requests;
+
+static void
+bench_arrange(void)
+{
+	start();
+	desktop_arrange(karuiwm.focus->selmon->seldt);
+	report("desktop_arrange", 1);
+}
+
+static void
+bench_attach(void)
+{
+	size_t i;
+	struct desktop *d = karuiwm.focus->selmon->seldt;
+
+	start();
+	for (i = 0; i < nclients; ++i)
+		desktop_attach_client(d, clients[i]);
+	report("desktop_attach_client", nclients);
+}
+
+static void
+bench_focus(void)
+{
+	size_t i;
+	struct desktop *d = karuiwm.focus->selmon->seldt;
+
+	desktop_set_focus(d, true);
+	start();
+	for (i = 0; i < rounds; ++i)
+		desktop_focus_client(d, clients[i * nclients / rounds]);
+	report("desktop_focus_client", rounds);
+}
+
+static void
+bench_free_slot(void)
+{
+	size_t i;
+	int x, y;
+	struct workspace *ws = workspace_new("model");
+
+	/* fill the grid around the initial desktop */
+	start();
+	for (i = 1; i < ndesktops; ++i)
+		workspace_attach_desktop(ws, desktop_new());
+	report("workspace_attach_desktop", ndesktops - 1);
+
+	start();
+	for (i = 0; i < rounds; ++i)
+		workspace_locate_free_slot(ws, &x, &y);
+	report("workspace_locate_free_slot", rounds);
+	workspace_delete(ws);
+}
+
+static void
+bench_locate(void)
+{
+	size_t i;
+	struct client *c;
+
+	/* spread the lookups over the whole client list */
+	start();
+	for (i = 0; i < rounds; ++i)
+		if (session_locate_window(karuiwm.session, &c,
+		    FIRST_WINDOW + (Window) (i * nclients / rounds)) < 0)
+			FATAL("window not found");
+	report("session_locate_window", rounds);
+}
+
+static void
+bench_new(void)
+{
+	size_t i;
+
+	clients = scalloc(nclients, sizeof(struct client *), "clients");
+	start();
+	for (i = 0; i < nclients; ++i) {
+		clients[i] = client_new(FIRST_WINDOW + (Window) i);
+		if (clients[i] == NULL)
+			FATAL("could not create client");
+	}
+	report("client_new", nclients);
+}
+
+static void
+bench_step_desktop(void)
+{
+	size_t i;
+	struct monitor *m = karuiwm.focus->selmon;
+
+	start();
+	for (i = 0; i < rounds; ++i) {
+		monitor_step_desktop(m, RIGHT);
+		monitor_step_desktop(m, LEFT);
+	}
+	report("monitor_step_desktop", 2 * rounds);
+}
+
+static void
+report(char const *metric, size_t nops)
+{
+	double ns = (double) (stats_now() - start_ns);
+	double requests = (double) (xstub_nrequests() - start_requests);
+
+	printf("{\"clients\":%zu,\"desktops\":%zu,\"metric\":\"%s\","
+	       "\"ops\":%zu,\"ns_per_op\":%.1f,\"requests_per_op\":%.1f}\n",
+	       nclients, ndesktops, metric, nops, ns / (double) nops,
+	       requests / (double) nops);
+	fflush(stdout);
+}
+
+static void
+start(void)
+{
+	start_requests = xstub_nrequests();
+	start_ns = stats_now();
+}
+
+int
+main(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "pn:d:r:")) != -1) {
+		switch (opt) {
+		case 'p': config.desktop.park = true; break;
+		case 'n': nclients = (size_t) strtoul(optarg, NULL, 10); break;
+		case 'd': ndesktops = (size_t) strtoul(optarg, NULL, 10); break;
+		case 'r': rounds = (size_t) strtoul(optarg, NULL, 10); break;
+		default:
+			fprintf(stderr, "usage: %s [-p] [-n CLIENTS] [-d DESKTOPS] "
+			        "[-r ROUNDS]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (nclients == 0 || ndesktops == 0 || rounds == 0)
+		return EXIT_FAILURE;
+
+	xstub_init_model();
+
+	bench_new();
+	bench_attach();
+	bench_arrange();
+	bench_focus();
+	bench_locate();
+	bench_step_desktop();
+	bench_free_slot();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Run the karuiwm benchmark suite on a private Xvfb server:
+#
+#   run.sh KARUIWM [CLIENTS ...]
+#
+# For each client count (10, 100 and 1000 by default), a fresh karuiwm is
+# started and the stress client is run against it. If it has been built, the
+# key latency harness is run afterwards against another fresh karuiwm. Results
+# are written to stdout as one JSON object per line.
+
+set -e
+
+if [ $# -lt 1 ]; then
+	echo "usage: $0 KARUIWM [CLIENTS ...]" >&2
+	exit 1
+fi
+wm="$1"
+shift
+counts="${*:-10 100 1000}"
+benchdir="$(dirname "$0")"
+
+# The screen must be tall enough for 1000 tiled windows in the stack area
+DISPLAY=":${BENCH_DISPLAY:-97}"
+export DISPLAY
+Xvfb "$DISPLAY" -screen 0 2560x4096x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+wmpid=
+trap 'kill $wmpid $xvfb 2>/dev/null' EXIT INT TERM
+
+"$benchdir/stress" -x "$benchdir/Xresources"
+for n in $counts; do
+	"$wm" -q &
+	wmpid=$!
+	"$benchdir/stress" -n "$n" -p "$wmpid"
+	kill "$wmpid"
+	wait "$wmpid" 2>/dev/null || true
+	wmpid=
+done
+
+if [ -x "$benchdir/keylat" ]; then
+	"$wm" -q &
+	wmpid=$!
+	"$benchdir/keylat"
+	kill "$wmpid"
+	wait "$wmpid" 2>/dev/null || true
+	wmpid=
+fi
@@ -0,0 +1,264 @@
+/* Stress client for the karuiwm benchmark suite, see run.sh.
+ *
+ *   stress -x FILE         load FILE into the RESOURCE_MANAGER property
+ *   stress -n N -p PID     run the benchmark with N windows against the
+ *                          window manager with process ID PID
+ *
+ * Results are written to stdout as one JSON object per line.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "bench.h"
+#include <X11/Xatom.h>
+#include <X11/keysym.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TITLES 10  /* title changes per window */
+#define CONFIGURES 10 /* configure requests per window */
+#define SWITCHES 20 /* desktop switch round trips */
+
+static double cpu_ms(void);
+static void load_resources(char const *path);
+static void phase_configure(void);
+static void phase_destroy(void);
+static void phase_map(void);
+static void phase_switch(void);
+static void phase_titles(void);
+static void report_throughput(char const *metric, size_t nevents,
+                              uint64_t start, double cpu_start);
+static void send_key(KeySym key, int unsigned mod);
+
+static Window *wins;
+static size_t nwins;
+static long wmpid;
+
+static double
+cpu_ms(void)
+{
+	char path[64], buf[1024], *p;
+	long unsigned utime, stime;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%ld/stat", wmpid);
+	f = fopen(path, "r");
+	if (f == NULL || fgets(buf, sizeof(buf), f) == NULL)
+		bench_die("could not read window manager CPU time");
+	fclose(f);
+
+	/* skip "pid (comm) state ppid pgrp session tty tpgid flags minflt
+	 * cminflt majflt cmajflt", comm may contain spaces */
+	p = strrchr(buf, ')');
+	if (p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u "
+	                        "%*u %*u %lu %lu", &utime, &stime) != 2)
+		bench_die("could not parse window manager CPU time");
+	return (double) (utime + stime) * 1000.0
+	     / (double) sysconf(_SC_CLK_TCK);
+}
+
+static void
+load_resources(char const *path)
+{
+	char *buf;
+	long len;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		bench_die("could not open resources file");
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc((size_t) len + 1);
+	if (buf == NULL || fread(buf, 1, (size_t) len, f) != (size_t) len)
+		bench_die("could not read resources file");
+	fclose(f);
+	XChangeProperty(dpy, root, XA_RESOURCE_MANAGER, XA_STRING, 8,
+	                PropModeReplace, (char unsigned *) buf, (int) len);
+	XSync(dpy, False);
+	free(buf);
+}
+
+static void
+phase_configure(void)
+{
+	size_t i, r;
+	uint64_t start = bench_now();
+	double cpu = cpu_ms();
+
+	for (r = 0; r < CONFIGURES; ++r)
+		for (i = 0; i < nwins; ++i)
+			XMoveResizeWindow(dpy, wins[i],
+			                  (int) (r * 10), (int) (i % 100),
+			                  50 + (int unsigned) r,
+			                  50 + (int unsigned) r);
+	bench_barrier();
+	report_throughput("configure_request", CONFIGURES * nwins, start, cpu);
+}
+
+static void
+phase_destroy(void)
+{
+	size_t i;
+	uint64_t start = bench_now();
+	double cpu = cpu_ms();
+
+	for (i = 0; i < nwins; ++i)
+		XDestroyWindow(dpy, wins[i]);
+	bench_barrier();
+	report_throughput("destroy", nwins, start, cpu);
+}
+
+static void
+phase_map(void)
+{
+	size_t i;
+	XEvent ev;
+	uint64_t *lat, start;
+	double cpu = cpu_ms();
+
+	lat = calloc(nwins, sizeof(uint64_t));
+	if (lat == NULL)
+		bench_die("out of memory");
+	start = bench_now();
+	for (i = 0; i < nwins; ++i) {
+		wins[i] = bench_create_window(false);
+		XStoreName(dpy, wins[i], "stress");
+		lat[i] = bench_now();
+		XMapWindow(dpy, wins[i]);
+		XFlush(dpy);
+
+		/* the window manager arranges before mapping */
+		do {
+			bench_next_event(&ev);
+		} while (ev.type != MapNotify || ev.xmap.window != wins[i]);
+		lat[i] = bench_now() - lat[i];
+	}
+	bench_report_latency(nwins, "map_to_arranged", lat, nwins);
+	report_throughput("map", nwins, start, cpu);
+	free(lat);
+}
+
+static void
+phase_switch(void)
+{
+	size_t r;
+	uint64_t *away, *back, t;
+	KeySym left = XK_Left, right = XK_Right;
+
+	away = calloc(SWITCHES, sizeof(uint64_t));
+	back = calloc(SWITCHES, sizeof(uint64_t));
+	if (away == NULL || back == NULL)
+		bench_die("out of memory");
+	for (r = 0; r < SWITCHES; ++r) {
+		t = bench_now();
+		send_key(right, Mod4Mask);
+		bench_wait_windows(wins, nwins, UnmapNotify);
+		away[r] = bench_now() - t;
+
+		t = bench_now();
+		send_key(left, Mod4Mask);
+		bench_wait_windows(wins, nwins, MapNotify);
+		back[r] = bench_now() - t;
+	}
+	bench_report_latency(nwins, "desktop_switch_away", away, SWITCHES);
+	bench_report_latency(nwins, "desktop_switch_back", back, SWITCHES);
+	free(away);
+	free(back);
+}
+
+static void
+phase_titles(void)
+{
+	size_t i, r;
+	char title[64];
+	uint64_t start = bench_now();
+	double cpu = cpu_ms();
+	Atom name = XInternAtom(dpy, "_NET_WM_NAME", False);
+	Atom utf8 = XInternAtom(dpy, "UTF8_STRING", False);
+
+	for (r = 0; r < TITLES; ++r) {
+		for (i = 0; i < nwins; ++i) {
+			snprintf(title, sizeof(title), "stress %zu: %zu", i, r);
+			XChangeProperty(dpy, wins[i], name, utf8, 8,
+			                PropModeReplace,
+			                (char unsigned *) title,
+			                (int) strlen(title));
+		}
+	}
+	bench_barrier();
+	report_throughput("title_change", TITLES * nwins, start, cpu);
+}
+
+static void
+report_throughput(char const *metric, size_t nevents, uint64_t start,
+                  double cpu_start)
+{
+	double wall = (double) (bench_now() - start) / 1000000.0;
+	double cpu = cpu_ms() - cpu_start;
+
+	printf("{\"clients\":%zu,\"metric\":\"%s\",\"events\":%zu,"
+	       "\"wall_ms\":%.1f,\"cpu_ms\":%.1f,"
+	       "\"cpu_ms_per_1000_events\":%.2f}\n",
+	       nwins, metric, nevents, wall, cpu,
+	       cpu * 1000.0 / (double) nevents);
+	fflush(stdout);
+}
+
+static void
+send_key(KeySym key, int unsigned mod)
+{
+	XEvent ev;
+
+	/* karuiwm selects KeyPressMask on the root window */
+	memset(&ev, 0, sizeof(ev));
+	ev.xkey.type = KeyPress;
+	ev.xkey.display = dpy;
+	ev.xkey.window = root;
+	ev.xkey.root = root;
+	ev.xkey.subwindow = None;
+	ev.xkey.time = CurrentTime;
+	ev.xkey.same_screen = True;
+	ev.xkey.state = mod;
+	ev.xkey.keycode = XKeysymToKeycode(dpy, key);
+	XSendEvent(dpy, root, False, KeyPressMask, &ev);
+	XFlush(dpy);
+}
+
+int
+main(int argc, char **argv)
+{
+	int opt;
+	char const *resources = NULL;
+
+	while ((opt = getopt(argc, argv, "n:p:x:")) != -1) {
+		switch (opt) {
+		case 'n': nwins = (size_t) strtoul(optarg, NULL, 10); break;
+		case 'p': wmpid = strtol(optarg, NULL, 10); break;
+		case 'x': resources = optarg; break;
+		default: bench_die("usage: stress -x FILE | -n N -p PID");
+		}
+	}
+	bench_open_display("stress");
+	if (resources != NULL) {
+		load_resources(resources);
+		return EXIT_SUCCESS;
+	}
+	if (nwins == 0 || wmpid <= 0)
+		bench_die("usage: stress -x FILE | -n N -p PID");
+	wins = calloc(nwins, sizeof(Window));
+	if (wins == NULL)
+		bench_die("out of memory");
+
+	bench_wait_for_wm();
+	phase_map();
+	phase_titles();
+	phase_configure();
+	phase_switch();
+	phase_destroy();
+
+	XCloseDisplay(dpy);
+	free(wins);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+/* Request-count tests of the core model, linked against the stub X library
+ * (xstub.c) like the model benchmarks:
+ *
+ *   test [-n CLIENTS]
+ *
+ * Each check compares the X requests an operation issues with what it is
+ * expected to cost. Failures are written to stderr, and make the exit status
+ * non-zero.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "xstub.h"
+#include "karuiwm.h"
+#include "client.h"
+#include "config.h"
+#include "desktop.h"
+#include "focus.h"
+#include "monitor.h"
+#include "steal.h"
+#include "tombstone.h"
+#include "util.h"
+#include "workspace.h"
+#include "xerror.h"
+#include <X11/Xproto.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FIRST_WINDOW 0x400000
+
+#define CHECK(COND, ...) check(COND, #COND, __LINE__, __VA_ARGS__)
+
+static void check(bool ok, char const *cond, int line, char const *fmt, ...);
+static size_t count_requests(char const *call, bool per_window);
+static char *dump(void (*dumpf)(FILE *f));
+static void test_arrange(void);
+static void test_focus(void);
+static void test_grid(void);
+static void test_park(void);
+static void test_slab(void);
+static void test_steal(void);
+static void test_tombstone(void);
+static void test_xerror(void);
+
+static size_t nclients = 1000, nfailures;
+static struct client **clients;
+
+static void
+check(bool ok, char const *cond, int line, char const *fmt, ...)
+{
+	va_list ap;
+
+	if (ok)
+		return;
+	++nfailures;
+	fprintf(stderr, "test.c:%d: %s failed: ", line, cond);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+static size_t
+count_requests(char const *call, bool per_window)
+{
+	size_t i, j, n, count = 0;
+	struct xstub_request const *r = xstub_requests(&n);
+
+	/* with per_window, only count the first request on each window */
+	for (i = 0; i < n; ++i) {
+		if (strcmp(r[i].call, call) != 0)
+			continue;
+		for (j = 0; per_window && j < i; ++j)
+			if (r[j].win == r[i].win && strcmp(r[j].call, call) == 0)
+				break;
+		if (!per_window || j == i)
+			++count;
+	}
+	return count;
+}
+
+static char *
+dump(void (*dumpf)(FILE *f))
+{
+	char *buf = NULL;
+	size_t len;
+	FILE *f;
+
+	/* the statistics a module writes to the -S dump */
+	f = open_memstream(&buf, &len);
+	if (f == NULL)
+		FATAL("open_memstream: %s", strerror(errno));
+	dumpf(f);
+	(void) fclose(f);
+	return buf;
+}
+
+static void
+test_arrange(void)
+{
+	long unsigned roundtrips = xstub_nroundtrips();
+
+	/* arranging must never wait for the X server */
+	desktop_arrange(karuiwm.focus->selmon->seldt);
+	CHECK(xstub_nroundtrips() == roundtrips, "desktop_arrange made %lu "
+	      "round trips", xstub_nroundtrips() - roundtrips);
+}
+
+static void
+test_focus(void)
+{
+	long unsigned requests;
+	struct desktop *d = karuiwm.focus->selmon->seldt;
+
+	/* the old and the new client, independent of the number of clients */
+	desktop_set_focus(d, true);
+	desktop_focus_client(d, clients[0]);
+	requests = xstub_nrequests();
+	desktop_focus_client(d, clients[nclients - 1]);
+	CHECK(xstub_nrequests() - requests == 3, "desktop_focus_client issued "
+	      "%lu requests", xstub_nrequests() - requests);
+}
+
+static void
+test_grid(void)
+{
+	int x, y, r;
+	size_t i, n = 100;
+	struct desktop **desktops, *d;
+	struct workspace *ws = workspace_new("test");
+
+	/* more desktops than initial buckets, so the grid is rehashed */
+	desktops = scalloc(n, sizeof(struct desktop *), "desktops");
+	desktops[0] = ws->desktops;
+	for (i = 1; i < n; ++i) {
+		desktops[i] = desktop_new();
+		workspace_attach_desktop(ws, desktops[i]);
+	}
+	for (i = 0; i < n; ++i) {
+		d = desktops[i];
+		CHECK(workspace_locate_desktop(ws, d->posx, d->posy) == d,
+		      "desktop %zu not found at (%d, %d)", i, d->posx, d->posy);
+		r = MAX(abs(d->posx), abs(d->posy));
+		CHECK(r <= 5, "desktop %zu at (%d, %d), outside the 11x11 "
+		      "square that holds %zu desktops", i, d->posx, d->posy, n);
+	}
+
+	/* a freed slot is handed out again before the ones after it */
+	d = desktops[n / 2];
+	x = d->posx;
+	y = d->posy;
+	workspace_detach_desktop(ws, d);
+	CHECK(workspace_locate_desktop(ws, x, y) == NULL,
+	      "detached desktop still found at (%d, %d)", x, y);
+	workspace_attach_desktop(ws, d);
+	CHECK(d->posx == x && d->posy == y, "freed slot (%d, %d) skipped "
+	      "for (%d, %d)", x, y, d->posx, d->posy);
+	sfree(desktops);
+	workspace_delete(ws);
+}
+
+static void
+test_park(void)
+{
+	size_t n;
+	struct monitor *m = karuiwm.focus->selmon;
+	struct desktop *d = m->seldt;
+
+	d->park = true;
+	monitor_step_desktop(m, RIGHT);
+
+	/* showing a parked desktop moves each window back, nothing else */
+	xstub_reset();
+	xstub_log(true);
+	monitor_step_desktop(m, LEFT);
+	xstub_log(false);
+	n = count_requests("XMoveResizeWindow", false);
+	CHECK(n == nclients, "%zu XMoveResizeWindow for %zu clients",
+	      n, nclients);
+	n = count_requests("XMoveResizeWindow", true);
+	CHECK(n == nclients, "XMoveResizeWindow on %zu of %zu clients",
+	      n, nclients);
+	n = count_requests("XMapWindow", false);
+	CHECK(n == 0, "%zu XMapWindow for parked clients", n);
+}
+
+static void
+test_slab(void)
+{
+	char *before, *after;
+	struct client *c = clients[nclients - 1], *reused;
+	struct desktop *d = c->desktop;
+
+	/* a deleted client's memory goes to the next one, no new chunk */
+	before = dump(slab_dump);
+	desktop_detach_client(d, c);
+	client_delete(c);
+	reused = client_new(FIRST_WINDOW + (Window) nclients);
+	after = dump(slab_dump);
+	CHECK(reused == c, "new client at %p instead of the freed %p",
+	      (void *) reused, (void *) c);
+	CHECK(strcmp(before, after) == 0, "slabs changed from\n%sto\n%s",
+	      before, after);
+	desktop_attach_client(d, reused);
+	clients[nclients - 1] = reused;
+	free(before);
+	free(after);
+}
+
+static void
+test_steal(void)
+{
+	bool first, second, third;
+	char *out;
+	Window win = FIRST_WINDOW + (Window) nclients + 1; /* not a client */
+
+	/* the first repeated steal is answered, then the backoff applies */
+	first = steal_record(win);
+	second = steal_record(win);
+	third = steal_record(win);
+	CHECK(first && second && !third, "steals answered: %d %d %d",
+	      first, second, third);
+	out = dump(steal_dump);
+	CHECK(strstr(out, "count=3 refocused=2 deferred=1") != NULL,
+	      "unexpected statistics:\n%s", out);
+	free(out);
+}
+
+static void
+test_tombstone(void)
+{
+	XEvent destroy = { 0 }, configure = { 0 };
+	Window win = clients[0]->win;
+
+	/* a DestroyNotify still in the queue makes the window a tombstone */
+	destroy.type = DestroyNotify;
+	destroy.xdestroywindow.window = win;
+	xstub_queue_event(&destroy);
+	tombstone_scan();
+	CHECK(tombstone_check(win), "window %lu not a tombstone", win);
+
+	/* its other events are dropped, the DestroyNotify itself is not */
+	configure.type = ConfigureRequest;
+	configure.xconfigurerequest.window = win;
+	CHECK(tombstone_filter(&configure), "ConfigureRequest not dropped");
+	CHECK(!tombstone_filter(&destroy), "DestroyNotify dropped");
+	CHECK(!tombstone_check(win), "window %lu still a tombstone after its "
+	      "DestroyNotify", win);
+	xstub_reset();
+}
+
+static void
+test_xerror(void)
+{
+	size_t i;
+	char *out;
+	XErrorEvent ee = { 0 };
+
+	/* the same error on many windows is one kind with a count; only the
+	 * first one of the period is logged */
+	ee.error_code = BadWindow;
+	ee.request_code = X_ConfigureWindow;
+	set_log_level(LOG_FATAL);
+	for (i = 0; i < 100; ++i) {
+		ee.resourceid = FIRST_WINDOW + i;
+		xerror_record(&ee);
+	}
+	set_log_level(LOG_ERROR);
+	out = dump(xerror_dump);
+	CHECK(strchr(out, '\n') == strrchr(out, '\n')
+	      && strstr(out, "count=100\n") != NULL,
+	      "unexpected statistics:\n%s", out);
+	free(out);
+}
+
+int
+main(int argc, char **argv)
+{
+	int opt;
+	size_t i;
+	struct desktop *d;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n': nclients = (size_t) strtoul(optarg, NULL, 10); break;
+		default:
+			fprintf(stderr, "usage: %s [-n CLIENTS]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (nclients < 2)
+		return EXIT_FAILURE;
+
+	xstub_init_model();
+
+	d = karuiwm.focus->selmon->seldt;
+	clients = scalloc(nclients, sizeof(struct client *), "clients");
+	for (i = 0; i < nclients; ++i) {
+		clients[i] = client_new(FIRST_WINDOW + (Window) i);
+		if (clients[i] == NULL)
+			FATAL("could not create client");
+		desktop_attach_client(d, clients[i]);
+		client_set_visibility(clients[i], true); /* as on MapRequest */
+	}
+
+	test_arrange();
+	test_focus();
+	test_park();
+	test_slab();
+	test_steal();
+	test_tombstone();
+	test_xerror();
+	test_grid();
+	if (nfailures > 0) {
+		fprintf(stderr, "%zu checks failed\n", nfailures);
+		return EXIT_FAILURE;
+	}
+	printf("all checks passed\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,894 @@
+/* Stub implementation of the Xlib calls karuiwm makes, for replaying event
+ * recordings without an X server:
+ *
+ *   LD_PRELOAD=bench/xstub.so karuiwm -R FILE
+ *
+ * or for linking the core modules into programs that run without a server (see
+ * model.c and test.c, which set the model up with xstub_init_model()). No
+ * request reaches a server. Each call is counted instead, and the counts are
+ * written to stderr when the display is closed. If enabled with xstub_log(),
+ * each request is also appended to an in-memory log.
+ *
+ * Queries return fixed answers: a 1920x1080 screen, viewable 640x480 windows
+ * named "xstub", no properties, no hints and no existing windows. The event
+ * queue only holds what was added with xstub_queue_event(). The X resources are
+ * read from the file named by XSTUB_RESOURCES (none if unset).
+ *
+ * xstub.so is built with XSTUB_PRELOAD, which leaves out xstub_init_model():
+ * the preloaded library cannot refer to the window manager it is loaded into.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "xstub.h"
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef XSTUB_PRELOAD
+#include "karuiwm.h"
+#include "focus.h"
+#include "layout.h"
+#include "session.h"
+#include "stats.h"
+#include "util.h"
+#endif
+
+#define ROOT 1
+#define COLORMAP 2
+#define SCREEN_WIDTH 1920
+#define SCREEN_HEIGHT 1080
+#define WINDOW_WIDTH 640
+#define WINDOW_HEIGHT 480
+#define WINDOW_NAME "xstub"
+#define FIRST_ATOM 100 /* above the predefined atoms in Xatom.h */
+#define FIRST_XID 0x7f000000
+#define EVENTS 64 /* queued with xstub_queue_event() */
+
+/* name, blocks on a reply (round trip) */
+#define CALLS \
+	CALL(XAllocNamedColor, true) \
+	CALL(XChangeProperty, false) \
+	CALL(XChangeWindowAttributes, false) \
+	CALL(XConfigureWindow, false) \
+	CALL(XCreateFontCursor, false) \
+	CALL(XCreateWindow, false) \
+	CALL(XDestroyWindow, false) \
+	CALL(XFreeCursor, false) \
+	CALL(XGetClassHint, true) \
+	CALL(XGetGeometry, true) \
+	CALL(XGetTextProperty, true) \
+	CALL(XGetTransientForHint, true) \
+	CALL(XGetWMClientMachine, true) \
+	CALL(XGetWMNormalHints, true) \
+	CALL(XGetWMProtocols, true) \
+	CALL(XGetWindowAttributes, true) \
+	CALL(XGetWindowProperty, true) \
+	CALL(XGrabButton, false) \
+	CALL(XGrabKey, false) \
+	CALL(XGrabPointer, true) \
+	CALL(XGrabServer, false) \
+	CALL(XInternAtom, true) \
+	CALL(XKillClient, false) \
+	CALL(XLowerWindow, false) \
+	CALL(XMapWindow, false) \
+	CALL(XMoveResizeWindow, false) \
+	CALL(XMoveWindow, false) \
+	CALL(XQueryPointer, true) \
+	CALL(XQueryTree, true) \
+	CALL(XResizeWindow, false) \
+	CALL(XRestackWindows, false) \
+	CALL(XSelectInput, false) \
+	CALL(XSendEvent, false) \
+	CALL(XSetCloseDownMode, false) \
+	CALL(XSetInputFocus, false) \
+	CALL(XSetWindowBorder, false) \
+	CALL(XSetWindowBorderWidth, false) \
+	CALL(XSync, true) \
+	CALL(XUngrabButton, false) \
+	CALL(XUngrabKey, false) \
+	CALL(XUngrabPointer, false) \
+	CALL(XUngrabServer, false) \
+	CALL(XUnmapWindow, false)
+
+enum call {
+#define CALL(NAME, RT) CALL_##NAME,
+	CALLS
+#undef CALL
+	CALL_LAST
+};
+
+static void request(Display *dpy, enum call call, Window win);
+
+static struct {
+	char const *name;
+	bool roundtrip;
+	long unsigned count;
+} calls[CALL_LAST] = {
+#define CALL(NAME, RT) [CALL_##NAME] = { #NAME, RT, 0 },
+	CALLS
+#undef CALL
+};
+static struct {
+	bool enabled;
+	struct xstub_request *requests;
+	size_t n, size;
+} reqlog;
+static struct {
+	XEvent events[EVENTS];
+	size_t n;
+} queue;
+static char **atomnames;
+static size_t natomnames;
+static XID nextxid = FIRST_XID;
+static char *resources;
+
+static void
+request(Display *dpy, enum call call, Window win)
+{
+	++calls[call].count;
+	++((_XPrivDisplay) dpy)->request;
+	if (!reqlog.enabled)
+		return;
+	if (reqlog.n == reqlog.size) {
+		reqlog.size = reqlog.size == 0 ? 1024 : 2 * reqlog.size;
+		reqlog.requests = realloc(reqlog.requests, reqlog.size
+		                          * sizeof(struct xstub_request));
+		if (reqlog.requests == NULL)
+			abort();
+	}
+	reqlog.requests[reqlog.n].call = calls[call].name;
+	reqlog.requests[reqlog.n].win = win;
+	++reqlog.n;
+}
+
+#ifndef XSTUB_PRELOAD
+void
+xstub_init_model(void)
+{
+	/* the part of init() the model depends on */
+	set_log_level(LOG_ERROR);
+	karuiwm.env.APPNAME = "karuiwm";
+	karuiwm.dpy = XOpenDisplay(NULL);
+	karuiwm.screen = DefaultScreen(karuiwm.dpy);
+	karuiwm.root = RootWindow(karuiwm.dpy, karuiwm.screen);
+	stats_init();
+	layout_init();
+	karuiwm.session = session_new();
+	karuiwm.focus = focus_new(karuiwm.session);
+}
+#endif
+
+void
+xstub_log(bool enabled)
+{
+	reqlog.enabled = enabled;
+}
+
+long unsigned
+xstub_nrequests(void)
+{
+	size_t i;
+	long unsigned n = 0;
+
+	for (i = 0; i < CALL_LAST; ++i)
+		n += calls[i].count;
+	return n;
+}
+
+long unsigned
+xstub_nroundtrips(void)
+{
+	size_t i;
+	long unsigned n = 0;
+
+	for (i = 0; i < CALL_LAST; ++i)
+		if (calls[i].roundtrip)
+			n += calls[i].count;
+	return n;
+}
+
+struct xstub_request const *
+xstub_requests(size_t *n)
+{
+	*n = reqlog.n;
+	return reqlog.requests;
+}
+
+void
+xstub_queue_event(XEvent const *ev)
+{
+	if (queue.n == EVENTS)
+		abort();
+	queue.events[queue.n++] = *ev;
+}
+
+void
+xstub_reset(void)
+{
+	size_t i;
+
+	for (i = 0; i < CALL_LAST; ++i)
+		calls[i].count = 0;
+	reqlog.n = 0;
+	queue.n = 0;
+}
+
+int
+XAllocNamedColor(Display *dpy, Colormap cm, char const *name, XColor *screen,
+                 XColor *exact)
+{
+	(void) cm;
+	(void) name;
+
+	request(dpy, CALL_XAllocNamedColor, None);
+	memset(screen, 0, sizeof(*screen));
+	memset(exact, 0, sizeof(*exact));
+	return 1;
+}
+
+int
+XChangeProperty(Display *dpy, Window win, Atom prop, Atom type, int format,
+                int mode, char unsigned const *data, int n)
+{
+	(void) prop;
+	(void) type;
+	(void) format;
+	(void) mode;
+	(void) data;
+	(void) n;
+
+	request(dpy, CALL_XChangeProperty, win);
+	return 1;
+}
+
+int
+XChangeWindowAttributes(Display *dpy, Window win, long unsigned mask,
+                        XSetWindowAttributes *wa)
+{
+	(void) mask;
+	(void) wa;
+
+	request(dpy, CALL_XChangeWindowAttributes, win);
+	return 1;
+}
+
+Bool
+XCheckIfEvent(Display *dpy, XEvent *ev,
+              Bool (*predicate)(Display *, XEvent *, XPointer), XPointer arg)
+{
+	size_t i;
+
+	for (i = 0; i < queue.n; ++i) {
+		if (predicate(dpy, &queue.events[i], arg)) {
+			*ev = queue.events[i];
+			memmove(&queue.events[i], &queue.events[i + 1],
+			        (queue.n - i - 1) * sizeof(XEvent));
+			--queue.n;
+			return True;
+		}
+	}
+	return False;
+}
+
+int
+XCloseDisplay(Display *dpy)
+{
+	size_t i;
+	long unsigned nrequests = 0, nroundtrips = 0;
+	_XPrivDisplay d = (_XPrivDisplay) dpy;
+
+	for (i = 0; i < CALL_LAST; ++i) {
+		if (calls[i].count == 0)
+			continue;
+		fprintf(stderr, "xstub %s count=%lu\n",
+		        calls[i].name, calls[i].count);
+		nrequests += calls[i].count;
+		if (calls[i].roundtrip)
+			nroundtrips += calls[i].count;
+	}
+	fprintf(stderr, "xstub total requests=%lu roundtrips=%lu\n",
+	        nrequests, nroundtrips);
+	free(reqlog.requests);
+
+	for (i = 0; i < natomnames; ++i)
+		free(atomnames[i]);
+	free(atomnames);
+	free(resources);
+	free(d->screens);
+	free(d);
+	return 0;
+}
+
+int
+XConfigureWindow(Display *dpy, Window win, int unsigned mask,
+                 XWindowChanges *wc)
+{
+	(void) mask;
+	(void) wc;
+
+	request(dpy, CALL_XConfigureWindow, win);
+	return 1;
+}
+
+Cursor
+XCreateFontCursor(Display *dpy, int unsigned shape)
+{
+	(void) shape;
+
+	request(dpy, CALL_XCreateFontCursor, None);
+	return nextxid++;
+}
+
+Window
+XCreateWindow(Display *dpy, Window parent, int x, int y, int unsigned w,
+              int unsigned h, int unsigned border, int depth,
+              int unsigned class, Visual *visual, long unsigned mask,
+              XSetWindowAttributes *wa)
+{
+	(void) x;
+	(void) y;
+	(void) w;
+	(void) h;
+	(void) border;
+	(void) depth;
+	(void) class;
+	(void) visual;
+	(void) mask;
+	(void) wa;
+
+	request(dpy, CALL_XCreateWindow, parent);
+	return nextxid++;
+}
+
+int
+XDestroyWindow(Display *dpy, Window win)
+{
+	request(dpy, CALL_XDestroyWindow, win);
+	return 1;
+}
+
+int
+XFree(void *data)
+{
+	free(data);
+	return 1;
+}
+
+int
+XFreeCursor(Display *dpy, Cursor cursor)
+{
+	(void) cursor;
+
+	request(dpy, CALL_XFreeCursor, None);
+	return 1;
+}
+
+void
+XFreeStringList(char **list)
+{
+	if (list == NULL)
+		return;
+	free(list[0]);
+	free(list);
+}
+
+int
+XGetClassHint(Display *dpy, Window win, XClassHint *ch)
+{
+	(void) ch;
+
+	request(dpy, CALL_XGetClassHint, win);
+	return 0;
+}
+
+int
+XGetErrorDatabaseText(Display *dpy, char const *name, char const *message,
+                      char const *def, char *buf, int len)
+{
+	(void) dpy;
+	(void) name;
+	(void) message;
+
+	snprintf(buf, (size_t) len, "%s", def);
+	return 0;
+}
+
+int
+XGetErrorText(Display *dpy, int code, char *buf, int len)
+{
+	(void) dpy;
+
+	snprintf(buf, (size_t) len, "X error %d", code);
+	return 0;
+}
+
+int
+XGetGeometry(Display *dpy, Drawable d, Window *root, int *x, int *y,
+             int unsigned *w, int unsigned *h, int unsigned *border,
+             int unsigned *depth)
+{
+	request(dpy, CALL_XGetGeometry, d);
+	*root = ROOT;
+	*x = *y = 0;
+	*w = WINDOW_WIDTH;
+	*h = WINDOW_HEIGHT;
+	*border = 0;
+	*depth = 24;
+	return 1;
+}
+
+int
+XGetTextProperty(Display *dpy, Window win, XTextProperty *text, Atom prop)
+{
+	(void) prop;
+
+	request(dpy, CALL_XGetTextProperty, win);
+	text->value = (char unsigned *) strdup(WINDOW_NAME);
+	text->encoding = XA_STRING;
+	text->format = 8;
+	text->nitems = strlen(WINDOW_NAME);
+	return 1;
+}
+
+int
+XGetTransientForHint(Display *dpy, Window win, Window *trans)
+{
+	(void) trans;
+
+	request(dpy, CALL_XGetTransientForHint, win);
+	return 0;
+}
+
+Status
+XGetWMClientMachine(Display *dpy, Window win, XTextProperty *text)
+{
+	(void) text;
+
+	request(dpy, CALL_XGetWMClientMachine, win);
+	return 0;
+}
+
+int
+XGetWMNormalHints(Display *dpy, Window win, XSizeHints *hints, long *supplied)
+{
+	request(dpy, CALL_XGetWMNormalHints, win);
+	memset(hints, 0, sizeof(*hints));
+	*supplied = 0;
+	return 1;
+}
+
+int
+XGetWMProtocols(Display *dpy, Window win, Atom **protocols, int *n)
+{
+	request(dpy, CALL_XGetWMProtocols, win);
+	*protocols = NULL;
+	*n = 0;
+	return 1;
+}
+
+int
+XGetWindowAttributes(Display *dpy, Window win, XWindowAttributes *wa)
+{
+	request(dpy, CALL_XGetWindowAttributes, win);
+	memset(wa, 0, sizeof(*wa));
+	wa->width = WINDOW_WIDTH;
+	wa->height = WINDOW_HEIGHT;
+	wa->depth = 24;
+	wa->root = ROOT;
+	wa->map_state = IsViewable;
+	wa->override_redirect = False;
+	wa->colormap = COLORMAP;
+	wa->screen = ((_XPrivDisplay) dpy)->screens;
+	return 1;
+}
+
+int
+XGetWindowProperty(Display *dpy, Window win, Atom prop, long offset,
+                   long len, int del, Atom req_type, Atom *type,
+                   int *format, long unsigned *nitems, long unsigned *after,
+                   char unsigned **data)
+{
+	(void) prop;
+	(void) offset;
+	(void) len;
+	(void) del;
+	(void) req_type;
+
+	request(dpy, CALL_XGetWindowProperty, win);
+	*type = None;
+	*format = 0;
+	*nitems = *after = 0;
+	*data = NULL;
+	return Success;
+}
+
+int
+XGrabButton(Display *dpy, int unsigned button, int unsigned mod, Window win,
+            int owner, int unsigned mask, int pmode, int kmode, Window confine,
+            Cursor cursor)
+{
+	(void) button;
+	(void) mod;
+	(void) owner;
+	(void) mask;
+	(void) pmode;
+	(void) kmode;
+	(void) confine;
+	(void) cursor;
+
+	request(dpy, CALL_XGrabButton, win);
+	return 1;
+}
+
+int
+XGrabKey(Display *dpy, int code, int unsigned mod, Window win, int owner,
+         int pmode, int kmode)
+{
+	(void) code;
+	(void) mod;
+	(void) owner;
+	(void) pmode;
+	(void) kmode;
+
+	request(dpy, CALL_XGrabKey, win);
+	return 1;
+}
+
+int
+XGrabPointer(Display *dpy, Window win, int owner, int unsigned mask,
+             int pmode, int kmode, Window confine, Cursor cursor, Time t)
+{
+	(void) owner;
+	(void) mask;
+	(void) pmode;
+	(void) kmode;
+	(void) confine;
+	(void) cursor;
+	(void) t;
+
+	request(dpy, CALL_XGrabPointer, win);
+	return GrabSuccess;
+}
+
+int
+XGrabServer(Display *dpy)
+{
+	request(dpy, CALL_XGrabServer, None);
+	return 1;
+}
+
+Atom
+XInternAtom(Display *dpy, char const *name, int only_if_exists)
+{
+	size_t i;
+	(void) only_if_exists;
+
+	request(dpy, CALL_XInternAtom, None);
+	for (i = 0; i < natomnames; ++i)
+		if (strcmp(atomnames[i], name) == 0)
+			return FIRST_ATOM + i;
+	atomnames = realloc(atomnames, (natomnames + 1) * sizeof(char *));
+	if (atomnames == NULL)
+		abort();
+	atomnames[natomnames] = strdup(name);
+	return FIRST_ATOM + natomnames++;
+}
+
+KeyCode
+XKeysymToKeycode(Display *dpy, KeySym keysym)
+{
+	(void) dpy;
+
+	return (KeyCode) keysym;
+}
+
+int
+XKillClient(Display *dpy, XID resource)
+{
+	request(dpy, CALL_XKillClient, resource);
+	return 1;
+}
+
+KeySym
+XLookupKeysym(XKeyEvent *e, int index)
+{
+	(void) index;
+
+	/* recordings carry the keysym in place of the keycode */
+	return (KeySym) e->keycode;
+}
+
+int
+XLowerWindow(Display *dpy, Window win)
+{
+	request(dpy, CALL_XLowerWindow, win);
+	return 1;
+}
+
+int
+XMapWindow(Display *dpy, Window win)
+{
+	request(dpy, CALL_XMapWindow, win);
+	return 1;
+}
+
+int
+XMaskEvent(Display *dpy, long mask, XEvent *ev)
+{
+	(void) dpy;
+	(void) mask;
+
+	/* there is no user to wait for: end mouse move/resize immediately */
+	memset(ev, 0, sizeof(*ev));
+	ev->type = ButtonRelease;
+	return 0;
+}
+
+int
+XMoveResizeWindow(Display *dpy, Window win, int x, int y, int unsigned w,
+                  int unsigned h)
+{
+	(void) x;
+	(void) y;
+	(void) w;
+	(void) h;
+
+	request(dpy, CALL_XMoveResizeWindow, win);
+	return 1;
+}
+
+int
+XMoveWindow(Display *dpy, Window win, int x, int y)
+{
+	(void) x;
+	(void) y;
+
+	request(dpy, CALL_XMoveWindow, win);
+	return 1;
+}
+
+int
+XNextEvent(Display *dpy, XEvent *ev)
+{
+	return XMaskEvent(dpy, 0, ev);
+}
+
+Display *
+XOpenDisplay(char const *name)
+{
+	_XPrivDisplay d;
+	Screen *scr;
+	(void) name;
+
+	d = calloc(1, sizeof(*d));
+	scr = calloc(1, sizeof(*scr));
+	if (d == NULL || scr == NULL)
+		return NULL;
+	scr->display = (Display *) d;
+	scr->root = ROOT;
+	scr->width = SCREEN_WIDTH;
+	scr->height = SCREEN_HEIGHT;
+	scr->root_depth = 24;
+	scr->cmap = COLORMAP;
+	d->fd = -1;
+	d->screens = scr;
+	d->nscreens = 1;
+	d->default_screen = 0;
+	return (Display *) d;
+}
+
+int
+XPending(Display *dpy)
+{
+	(void) dpy;
+
+	return 0;
+}
+
+int
+XQueryPointer(Display *dpy, Window win, Window *root, Window *child,
+              int *rx, int *ry, int *wx, int *wy, int unsigned *mask)
+{
+	request(dpy, CALL_XQueryPointer, win);
+	*root = ROOT;
+	*child = None;
+	*rx = *ry = *wx = *wy = 0;
+	*mask = 0;
+	return True;
+}
+
+int
+XQueryTree(Display *dpy, Window win, Window *root, Window *parent,
+           Window **children, int unsigned *n)
+{
+	request(dpy, CALL_XQueryTree, win);
+	*root = ROOT;
+	*parent = None;
+	*children = NULL;
+	*n = 0;
+	return 1;
+}
+
+int
+XResizeWindow(Display *dpy, Window win, int unsigned w, int unsigned h)
+{
+	(void) w;
+	(void) h;
+
+	request(dpy, CALL_XResizeWindow, win);
+	return 1;
+}
+
+char *
+XResourceManagerString(Display *dpy)
+{
+	char const *path = getenv("XSTUB_RESOURCES");
+	long len;
+	FILE *f;
+	(void) dpy;
+
+	if (resources != NULL)
+		return resources;
+	if (path != NULL && (f = fopen(path, "r")) != NULL) {
+		fseek(f, 0, SEEK_END);
+		len = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		resources = calloc((size_t) len + 1, 1);
+		if (resources != NULL
+		&& fread(resources, 1, (size_t) len, f) != (size_t) len)
+			resources[0] = '\0';
+		fclose(f);
+	}
+	if (resources == NULL)
+		resources = calloc(1, 1);
+	return resources;
+}
+
+int
+XRestackWindows(Display *dpy, Window *wins, int n)
+{
+	(void) wins;
+	(void) n;
+
+	request(dpy, CALL_XRestackWindows, None);
+	return 1;
+}
+
+int
+XSelectInput(Display *dpy, Window win, long mask)
+{
+	(void) mask;
+
+	request(dpy, CALL_XSelectInput, win);
+	return 1;
+}
+
+int
+XSendEvent(Display *dpy, Window win, int propagate, long mask, XEvent *ev)
+{
+	(void) propagate;
+	(void) mask;
+	(void) ev;
+
+	request(dpy, CALL_XSendEvent, win);
+	return 1;
+}
+
+int
+XSetCloseDownMode(Display *dpy, int mode)
+{
+	(void) mode;
+
+	request(dpy, CALL_XSetCloseDownMode, None);
+	return 1;
+}
+
+XErrorHandler
+XSetErrorHandler(XErrorHandler handler)
+{
+	(void) handler;
+
+	return NULL;
+}
+
+int
+XSetInputFocus(Display *dpy, Window win, int revert, Time t)
+{
+	(void) revert;
+	(void) t;
+
+	request(dpy, CALL_XSetInputFocus, win);
+	return 1;
+}
+
+int
+XSetWindowBorder(Display *dpy, Window win, long unsigned pixel)
+{
+	(void) pixel;
+
+	request(dpy, CALL_XSetWindowBorder, win);
+	return 1;
+}
+
+int
+XSetWindowBorderWidth(Display *dpy, Window win, int unsigned width)
+{
+	(void) width;
+
+	request(dpy, CALL_XSetWindowBorderWidth, win);
+	return 1;
+}
+
+int
+XSupportsLocale(void)
+{
+	return True;
+}
+
+int
+XSync(Display *dpy, int discard)
+{
+	(void) discard;
+
+	request(dpy, CALL_XSync, None);
+	return 1;
+}
+
+int
+XUngrabButton(Display *dpy, int unsigned button, int unsigned mod, Window win)
+{
+	(void) button;
+	(void) mod;
+
+	request(dpy, CALL_XUngrabButton, win);
+	return 1;
+}
+
+int
+XUngrabKey(Display *dpy, int code, int unsigned mod, Window win)
+{
+	(void) code;
+	(void) mod;
+
+	request(dpy, CALL_XUngrabKey, win);
+	return 1;
+}
+
+int
+XUngrabPointer(Display *dpy, Time t)
+{
+	(void) t;
+
+	request(dpy, CALL_XUngrabPointer, None);
+	return 1;
+}
+
+int
+XUngrabServer(Display *dpy)
+{
+	request(dpy, CALL_XUngrabServer, None);
+	return 1;
+}
+
+int
+XUnmapWindow(Display *dpy, Window win)
+{
+	request(dpy, CALL_XUnmapWindow, win);
+	return 1;
+}
+
+int
+Xutf8TextPropertyToTextList(Display *dpy, XTextProperty const *text,
+                            char ***list, int *n)
+{
+	(void) dpy;
+
+	*list = malloc(sizeof(char *));
+	if (*list == NULL)
+		return XNoMemory;
+	(*list)[0] = strndup((char const *) text->value, text->nitems);
+	*n = 1;
+	return Success;
+}
@@ -0,0 +1,21 @@
+#ifndef _KARUIWM_XSTUB_H
+#define _KARUIWM_XSTUB_H
+
+#include <X11/Xlib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct xstub_request {
+	char const *call;
+	Window win;
+};
+
+void xstub_init_model(void);
+void xstub_log(bool enabled);
+long unsigned xstub_nrequests(void);
+long unsigned xstub_nroundtrips(void);
+void xstub_queue_event(XEvent const *ev);
+struct xstub_request const *xstub_requests(size_t *n);
+void xstub_reset(void);
+
+#endif /* ndef _KARUIWM_XSTUB_H */
@@ -1,5 +1,6 @@
 #include "action.h"
 #include "util.h"
+#include "probe.h"
 
 void
 action_delete(struct action *a)
@@ -8,6 +9,18 @@ action_delete(struct action *a)
 	sfree(a);
 }
 
+void
+action_invoke(struct action *a, union argument *arg)
+{
+	struct stats_timer t;
+
+	PROBE1(action_begin, a->name);
+	stats_start(&t, &a->stats);
+	a->function(arg);
+	stats_stop(&t);
+	PROBE1(action_end, a->name);
+}
+
 struct action *
 action_new(char const *name, void (*function)(union argument *),
            enum argument_type argtype)
@@ -18,5 +31,6 @@ action_new(char const *name, void (*function)(union argument *),
 	a->name = strdupf(name);
 	a->function = function;
 	a->argtype = argtype;
+	stats_init_entry(&a->stats, "action", a->name);
 	return a;
 }
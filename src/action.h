@@ -2,15 +2,18 @@
 #define _KARUIWM_ACTION_H
 
 #include "argument.h"
+#include "stats.h"
 
 struct action {
 	struct action *prev, *next;
 	char *name;
 	void (*function)(union argument *arg);
 	enum argument_type argtype;
+	struct stats_entry stats;
 };
 
 void action_delete(struct action *a);
+void action_invoke(struct action *a, union argument *arg);
 struct action *action_new(char const *name, void (*function)(union argument *),
                           enum argument_type argtype);
 
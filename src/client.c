@@ -1,15 +1,33 @@
 #include "karuiwm.h"
 #include "client.h"
+#include "desktop.h"
 #include "util.h"
 #include "config.h"
+#include "stats.h"
+#include "trace.h"
+#include "probe.h"
+#include "tombstone.h"
+#include "process.h"
+#include <stdio.h>
 #include <string.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
 #include <stdarg.h>
 
+/* flags for client.published */
+#define PUBLISHED 0x1
+#define PUBLISHED_HIDDEN 0x2
+#define PUBLISHED_FULLSCREEN 0x4
+
+#define NETSTATE_MAX 32L /* _NET_WM_STATE atoms read */
+
 static int check_sizehints(struct client *c, int unsigned *w, int unsigned *h);
-static int get_name(char *buf, size_t buflen, Window win);
+static int get_name(struct client *c);
 static void massacre(struct client *c);
+static void set_name(struct client *c, char const *name);
+
+static struct slab client_slab = SLAB_INIT("client", struct client);
+static struct slab cold_slab = SLAB_INIT("client cold", struct client_cold);
 
 static int
 check_sizehints(struct client *c, int unsigned *w, int unsigned *h)
@@ -22,23 +40,23 @@ check_sizehints(struct client *c, int unsigned *w, int unsigned *h)
 		return *w == c->w && *h == c->h ? 0 : -1;
 
 	if (*w != c->w) {
-		if (c->basew > 0 && c->incw > 0) {
-			u = (*w - c->basew)/c->incw;
-			*w = c->basew + u*c->incw;
+		if (c->cold->basew > 0 && c->cold->incw > 0) {
+			u = (*w - c->cold->basew)/c->cold->incw;
+			*w = c->cold->basew + u*c->cold->incw;
 		}
-		*w = MAX(*w, MAX(c->minw, 1));
-		if (c->maxw > 0)
-			*w = MIN(*w, c->maxw);
+		*w = MAX(*w, MAX(c->cold->minw, 1));
+		if (c->cold->maxw > 0)
+			*w = MIN(*w, c->cold->maxw);
 		change |= *w != c->w;
 	}
 	if (*h != c->h) {
-		if (c->baseh > 0 && c->inch > 0) {
-			u = (*h - c->baseh)/c->inch;
-			*h = c->baseh + u*c->inch;
+		if (c->cold->baseh > 0 && c->cold->inch > 0) {
+			u = (*h - c->cold->baseh)/c->cold->inch;
+			*h = c->cold->baseh + u*c->cold->inch;
 		}
-		*h = MAX(*h, MAX(c->minh, 1));
-		if (c->maxh > 0)
-			*h = MIN(*h, c->maxh);
+		*h = MAX(*h, MAX(c->cold->minh, 1));
+		if (c->cold->maxh > 0)
+			*h = MIN(*h, c->cold->maxh);
 		change |= *h != c->h;
 	}
 	return change ? -1 : 0;
@@ -47,9 +65,15 @@ check_sizehints(struct client *c, int unsigned *w, int unsigned *h)
 void
 client_delete(struct client *c)
 {
-	if (c->supported != NULL)
-		sfree(c->supported);
-	sfree(c);
+	if (c->cold->process != NULL)
+		process_detach(c->cold->process, c->visible,
+		               c->cold->freeze == 0);
+	sfree(c->cold->name);
+	sfree(c->cold->class);
+	sfree(c->cold->supported);
+	sfree(c->cold->netstate);
+	slab_free(&cold_slab, c->cold);
+	slab_free(&client_slab, c);
 }
 
 void
@@ -71,7 +95,8 @@ client_kill(struct client *c)
 	int i;
 
 	if (!client_supports_atom(c, atoms[WM_DELETE_WINDOW])) {
-		WARN("WM_DELETE_WINDOW not supported by %lu", c->win);
+		WARN_LIMIT("WM_DELETE_WINDOW not supported by %lu",
+		           c->win);
 		massacre(c);
 		return;
 	}
@@ -94,6 +119,9 @@ client_move(struct client *c, int x, int y)
 		c->floatx = x;
 		c->floaty = y;
 	}
+	/* parked windows are configured when they are shown */
+	if (c->parked)
+		return;
 	XMoveWindow(karuiwm.dpy, c->win, c->x, c->y);
 }
 
@@ -110,40 +138,91 @@ client_new(Window win)
 {
 	struct client *c;
 	XWindowAttributes wa;
+	struct trace_span s;
+
+	PROBE1(client_new_begin, win);
 
 	/* ignore buggy windows and windows with override_redirect */
-	if (!XGetWindowAttributes(karuiwm.dpy, win, &wa)) {
-		WARN("XGetWindowAttributes() failed for window %lu", win);
+	if (!ROUNDTRIP(XGetWindowAttributes(karuiwm.dpy, win, &wa))) {
+		WARN_LIMIT("XGetWindowAttributes() failed for window %lu",
+		           win);
+		PROBE2(client_new_end, win, NULL);
 		return NULL;
 	}
-	if (wa.override_redirect)
+	if (wa.override_redirect) {
+		PROBE2(client_new_end, win, NULL);
 		return NULL;
+	}
 
 	/* initialise client with default values */
-	c = smalloc(sizeof(struct client), "client");
+	c = slab_alloc(&client_slab);
 	c->next = c->prev = NULL;
 	c->win = win;
 	c->floating = false;
 	c->dialog = false;
 	c->transient = false;
+	c->visible = false;
+	c->park = c->parked = false;
+	c->published = 0;
 	c->state = STATE_NORMAL;
 	c->w = c->h = c->floatw = c->floath = 0;
 	c->x = c->y = c->floatx = c->floaty = 0;
-	c->nsup = 0;
-	c->supported = NULL;
+	c->cold = slab_alloc(&cold_slab);
+	memset(c->cold, 0, sizeof(struct client_cold));
+	c->cold->freeze = -1;
 
 	/* query client properties */
+	trace_begin(&s, "client", "new");
+	s.win = win;
+	client_query_class(c);
 	client_query_dialog(c);
 	client_query_sizehints(c);
 	client_query_dimension(c);
 	client_query_fullscreen(c);
 	client_query_name(c);
+	client_query_process(c);
 	client_query_supported_atoms(c);
 	client_query_transient(c);
+	c->focused = false;
+	XSetWindowBorder(karuiwm.dpy, c->win, config.border.colour);
+	trace_text(&s, c->cold->name);
+	trace_end(&s);
+	PROBE2(client_new_end, win, c->cold->name);
 
 	return c;
 }
 
+void
+client_publish_state(struct client *c)
+{
+	long wmstate[2] = { NormalState, None };
+	Atom *netstate = c->cold->netstate;
+	int n = (int) c->cold->nnetstate;
+	char unsigned published = PUBLISHED;
+
+	/* the atoms we do not manage, as read by client_query_fullscreen(), are
+	 * followed by the ones we do; netstate has room for both */
+	if (c->state == STATE_FULLSCREEN) {
+		netstate[n++] = netatoms[_NET_WM_STATE_FULLSCREEN];
+		published |= PUBLISHED_FULLSCREEN;
+	}
+	if (!c->visible) {
+		netstate[n++] = netatoms[_NET_WM_STATE_HIDDEN];
+		published |= PUBLISHED_HIDDEN;
+		wmstate[0] = IconicState;
+	}
+	if (published == c->published || tombstone_check(c->win))
+		return;
+
+	if ((published ^ c->published) & (PUBLISHED | PUBLISHED_HIDDEN))
+		XChangeProperty(karuiwm.dpy, c->win, atoms[WM_STATE],
+		                atoms[WM_STATE], 32, PropModeReplace,
+		                (char unsigned *) wmstate, 2);
+	XChangeProperty(karuiwm.dpy, c->win, netatoms[_NET_WM_STATE], XA_ATOM,
+	                32, PropModeReplace, (char unsigned *) netstate, n);
+	c->published = published;
+}
+
 Atom
 client_query_atom(struct client *c, Atom property)
 {
@@ -152,9 +231,9 @@ client_query_atom(struct client *c, Atom property)
 	char unsigned *atomp = NULL;
 	Atom a, atom = None;
 
-	ret = XGetWindowProperty(karuiwm.dpy, c->win, property, 0L,
-	                         sizeof(Atom), False, XA_ATOM, &a, &i, &lu, &lu,
-	                         &atomp);
+	ret = ROUNDTRIP(XGetWindowProperty(karuiwm.dpy, c->win, property, 0L,
+	                                   sizeof(Atom), False, XA_ATOM, &a, &i,
+	                                   &lu, &lu, &atomp));
 	if (ret != Success) {
 		WARN("%lu: could not get property", c->win);
 	} else if (atomp != NULL) {
@@ -164,6 +243,28 @@ client_query_atom(struct client *c, Atom property)
 	return atom;
 }
 
+void
+client_query_class(struct client *c)
+{
+	char key[128];
+	bool freeze;
+	XClassHint ch = { NULL, NULL };
+
+	if (!ROUNDTRIP(XGetClassHint(karuiwm.dpy, c->win, &ch)))
+		return;
+	if (ch.res_class != NULL) {
+		c->cold->class = strdupf("%s", ch.res_class);
+		(void) snprintf(key, sizeof(key), "park.%s", ch.res_class);
+		(void) config_get_bool(key, false, &c->park);
+		(void) snprintf(key, sizeof(key), "freeze.%s", ch.res_class);
+		if (config_get_bool(key, false, &freeze) == 0)
+			c->cold->freeze = freeze;
+		XFree(ch.res_class);
+	}
+	if (ch.res_name != NULL)
+		XFree(ch.res_name);
+}
+
 void
 client_query_dialog(struct client *c)
 {
@@ -179,8 +280,9 @@ client_query_dimension(struct client *c)
 	Window root;
 	int unsigned u;
 
-	if (!XGetGeometry(karuiwm.dpy, c->win, &root, &c->floatx, &c->floaty,
-	                  &c->floatw, &c->floath, &c->border, &u)) {
+	if (!ROUNDTRIP(XGetGeometry(karuiwm.dpy, c->win, &root,
+	                            &c->floatx, &c->floaty,
+	                            &c->floatw, &c->floath, &c->border, &u))) {
 		WARN("window %lu: could not get geometry", c->win);
 		return;
 	}
@@ -195,18 +297,78 @@ client_query_dimension(struct client *c)
 void
 client_query_fullscreen(struct client *c)
 {
-	Atom state;
-
-	state = client_query_atom(c, netatoms[_NET_WM_STATE]);
-	client_set_fullscreen(c, state == netatoms[_NET_WM_STATE_FULLSCREEN]);
+	int ret, format;
+	long unsigned i, n, after;
+	char unsigned *data = NULL;
+	Atom type, *state;
+	bool fullscreen = false;
+
+	/* keep the state atoms we do not manage for client_publish_state();
+	 * after mapping, only the window manager changes _NET_WM_STATE */
+	ret = ROUNDTRIP(XGetWindowProperty(karuiwm.dpy, c->win,
+	                                   netatoms[_NET_WM_STATE], 0L,
+	                                   NETSTATE_MAX, False, XA_ATOM, &type,
+	                                   &format, &n, &after, &data));
+	if (ret != Success) {
+		WARN("%lu: could not get property", c->win);
+		n = 0;
+	}
+	if (data == NULL || format != 32)
+		n = 0;
+	state = (Atom *) data;
+	c->cold->nnetstate = 0;
+	c->cold->netstate = srealloc(c->cold->netstate, (n + 2) * sizeof(Atom),
+	                             "window state atoms");
+	for (i = 0; i < n; ++i) {
+		if (state[i] == netatoms[_NET_WM_STATE_FULLSCREEN])
+			fullscreen = true;
+		else if (state[i] != netatoms[_NET_WM_STATE_HIDDEN])
+			c->cold->netstate[c->cold->nnetstate++] = state[i];
+	}
+	if (data != NULL)
+		XFree(data);
+	client_set_fullscreen(c, fullscreen);
 }
 
 void
 client_query_name(struct client *c)
 {
-	if (get_name(c->name, CLIENT_NAMELEN, c->win) < 0 || c->name[0] == '\0')
-		strcpy(c->name, "[broken]");
-	c->name[CLIENT_NAMELEN-1] = '\0';
+	if (get_name(c) < 0 || c->cold->name[0] == '\0')
+		set_name(c, "[broken]");
+}
+
+void
+client_query_process(struct client *c)
+{
+	int ret, format;
+	int long unsigned n, after;
+	char unsigned *data = NULL;
+	Atom type;
+	XTextProperty machine;
+	bool local;
+
+	if (!config.freeze.enable && !config.priority.enable)
+		return;
+
+	/* _NET_WM_PID is only meaningful on the client's machine */
+	if (!ROUNDTRIP(XGetWMClientMachine(karuiwm.dpy, c->win, &machine)))
+		return;
+	local = machine.value != NULL
+	     && process_is_local((char const *) machine.value);
+	if (machine.value != NULL)
+		XFree(machine.value);
+	if (!local)
+		return;
+
+	ret = ROUNDTRIP(XGetWindowProperty(karuiwm.dpy, c->win,
+	                                   netatoms[_NET_WM_PID], 0L, 1L,
+	                                   False, XA_CARDINAL, &type, &format,
+	                                   &n, &after, &data));
+	if (ret == Success && data != NULL && n == 1 && format == 32)
+		c->cold->process = process_attach((pid_t) *(long *) data,
+		                                  c->cold->freeze == 0);
+	if (data != NULL)
+		XFree(data);
 }
 
 void
@@ -215,47 +377,47 @@ client_query_sizehints(struct client *c)
 	long size;
 	XSizeHints hints;
 
-	if (!XGetWMNormalHints(karuiwm.dpy, c->win, &hints, &size)) {
-		WARN("XGetWMNormalHints() failed");
+	if (!ROUNDTRIP(XGetWMNormalHints(karuiwm.dpy, c->win, &hints, &size))) {
+		WARN_LIMIT("XGetWMNormalHints() failed");
 		return;
 	}
 
 	/* base size */
 	if (hints.flags & PBaseSize) {
-		c->basew = (int unsigned) hints.base_width;
-		c->baseh = (int unsigned) hints.base_height;
+		c->cold->basew = (int unsigned) hints.base_width;
+		c->cold->baseh = (int unsigned) hints.base_height;
 	} else if (hints.flags & PMinSize) {
-		c->basew = (int unsigned) hints.min_width;
-		c->baseh = (int unsigned) hints.min_height;
+		c->cold->basew = (int unsigned) hints.min_width;
+		c->cold->baseh = (int unsigned) hints.min_height;
 	} else {
-		c->basew = c->baseh = 0;
+		c->cold->basew = c->cold->baseh = 0;
 	}
 
 	/* resize steps */
 	if (hints.flags & PResizeInc) {
-		c->incw = (int unsigned) hints.width_inc;
-		c->inch = (int unsigned) hints.height_inc;
+		c->cold->incw = (int unsigned) hints.width_inc;
+		c->cold->inch = (int unsigned) hints.height_inc;
 	} else {
-		c->incw = c->inch = 0;
+		c->cold->incw = c->cold->inch = 0;
 	}
 
 	/* minimum size */
 	if (hints.flags & PMinSize) {
-		c->minw = (int unsigned) hints.min_width;
-		c->minh = (int unsigned) hints.min_height;
+		c->cold->minw = (int unsigned) hints.min_width;
+		c->cold->minh = (int unsigned) hints.min_height;
 	} else if (hints.flags & PBaseSize) {
-		c->minw = (int unsigned) hints.base_width;
-		c->minh = (int unsigned) hints.base_height;
+		c->cold->minw = (int unsigned) hints.base_width;
+		c->cold->minh = (int unsigned) hints.base_height;
 	} else {
-		c->minw = c->minh = 0;
+		c->cold->minw = c->cold->minh = 0;
 	}
 
 	/* maximum size */
 	if (hints.flags & PMaxSize) {
-		c->maxw = (int unsigned) hints.max_width;
-		c->maxw = (int unsigned) hints.max_height;
+		c->cold->maxw = (int unsigned) hints.max_width;
+		c->cold->maxw = (int unsigned) hints.max_height;
 	} else {
-		c->maxw = c->maxh = 0;
+		c->cold->maxw = c->cold->maxh = 0;
 	}
 }
 
@@ -265,18 +427,19 @@ client_query_supported_atoms(struct client *c)
 	int unsigned i, nsup;
 	Atom *sup;
 
-	if (c->supported != NULL) {
-		sfree(c->supported);
-		nsup = 0;
-	}
-	if (!XGetWMProtocols(karuiwm.dpy, c->win, &sup, (int signed *) &nsup)) {
-		WARN("XGetWMProtocols() failed on %lu", c->win);
+	sfree(c->cold->supported);
+	c->cold->supported = NULL;
+	c->cold->nsup = 0;
+	if (!ROUNDTRIP(XGetWMProtocols(karuiwm.dpy, c->win, &sup,
+	                               (int signed *) &nsup))) {
+		WARN_LIMIT("XGetWMProtocols() failed on %lu", c->win);
 		return;
 	}
-	c->nsup = (size_t) nsup;
-	c->supported = scalloc(nsup, sizeof(Atom), "supported atoms list");
+	c->cold->nsup = (size_t) nsup;
+	c->cold->supported = scalloc(nsup, sizeof(Atom),
+	                             "supported atoms list");
 	for (i = 0; i < nsup; ++i)
-		c->supported[i] = sup[i];
+		c->cold->supported[i] = sup[i];
 	XFree(sup);
 }
 
@@ -285,7 +448,7 @@ client_query_transient(struct client *c)
 {
 	Window trans = 0;
 
-	if (XGetTransientForHint(karuiwm.dpy, c->win, &trans)) {
+	if (ROUNDTRIP(XGetTransientForHint(karuiwm.dpy, c->win, &trans))) {
 		c->transient = true;
 		DEBUG("window %lu is transient", c->win);
 	}
@@ -302,6 +465,8 @@ client_resize(struct client *c, int unsigned w, int unsigned h)
 		c->floatw = w;
 		c->floath = h;
 	}
+	if (c->parked)
+		return;
 	XResizeWindow(karuiwm.dpy, c->win, c->w, c->h);
 }
 
@@ -317,6 +482,8 @@ client_send_atom(struct client *c, size_t natoms, ...)
 		WARN("attempt to send %zu atoms", natoms);
 		return -1;
 	}
+	if (tombstone_check(c->win))
+		return -1;
 	va_start(args, natoms);
 
 	ev.type = ClientMessage;
@@ -358,8 +525,14 @@ client_set_floating(struct client *c, bool floating)
 void
 client_set_focus(struct client *c, bool focus)
 {
-	XSetWindowBorder(karuiwm.dpy, c->win, focus ? config.border.colour_focus
-	                                            : config.border.colour);
+	if (tombstone_check(c->win))
+		return;
+	if (c->focused != focus) {
+		c->focused = focus;
+		XSetWindowBorder(karuiwm.dpy, c->win,
+		                 focus ? config.border.colour_focus
+		                       : config.border.colour);
+	}
 	if (focus)
 		XSetInputFocus(karuiwm.dpy, c->win, RevertToParent,
 		               CurrentTime);
@@ -375,17 +548,30 @@ client_set_fullscreen(struct client *c, bool fullscreen)
 void
 client_set_visibility(struct client *c, bool visible)
 {
-	Atom action;
-
+	if (c->visible == visible)
+		return;
 	c->visible = visible;
-	if (c->visible)
+	if (c->cold->process != NULL) {
+		if (visible)
+			process_show(c->cold->process);
+		else
+			process_hide(c->cold->process, c->cold->freeze == 1
+			             || (c->cold->freeze < 0 && c->desktop != NULL
+			                 && c->desktop->freeze));
+	}
+	if (c->visible && c->parked) {
+		c->parked = false;
+		XMoveResizeWindow(karuiwm.dpy, c->win, c->x, c->y, c->w, c->h);
+	} else if (c->visible) {
 		XMapWindow(karuiwm.dpy, c->win);
-	else
+	} else if (c->park || (c->desktop != NULL && c->desktop->park)) {
+		/* keep the window mapped, just out of the root geometry */
+		c->parked = true;
+		XMoveWindow(karuiwm.dpy, c->win,
+		            -(int signed) (c->w + 2 * c->border), c->y);
+	} else {
 		XUnmapWindow(karuiwm.dpy, c->win);
-
-	action = visible ? _NET_WM_STATE_ADD : _NET_WM_STATE_REMOVE;
-	client_send_atom(c, 3, netatoms[_NET_WM_STATE], action,
-	                 netatoms[_NET_WM_STATE_HIDDEN]);
+	}
 }
 
 bool
@@ -393,34 +579,42 @@ client_supports_atom(struct client *c, Atom atom)
 {
 	int unsigned i;
 
-	for (i = 0; i < c->nsup; ++i)
-		if (c->supported[i] == atom)
+	for (i = 0; i < c->cold->nsup; ++i)
+		if (c->cold->supported[i] == atom)
 			return true;
 	return false;
 }
 
+void
+client_unpark(struct client *c)
+{
+	if (!c->parked)
+		return;
+	c->parked = false;
+	XUnmapWindow(karuiwm.dpy, c->win);
+	XMoveResizeWindow(karuiwm.dpy, c->win, c->x, c->y, c->w, c->h);
+}
+
 static int
-get_name(char *buf, size_t buflen, Window win)
+get_name(struct client *c)
 {
 	XTextProperty text_prop;
 	int n, ret, fret = 0;
 	char **list;
 
-	XGetTextProperty(karuiwm.dpy, win, &text_prop, netatoms[_NET_WM_NAME]);
+	(void) ROUNDTRIP(XGetTextProperty(karuiwm.dpy, c->win, &text_prop,
+	                                  netatoms[_NET_WM_NAME]));
 	if (text_prop.nitems == 0)
 		return -1;
-	if (text_prop.encoding == XA_STRING) {
-		strncpy(buf, (char const *) text_prop.value, 255);
-	} else {
-		ret = XmbTextPropertyToTextList(karuiwm.dpy, &text_prop, &list,
-		                                &n);
-		if (ret != Success || n <= 0) {
-			fret = -1;
-			goto get_name_out;
-		}
-		strncpy(buf, list[0], buflen);
-		XFreeStringList(list);
+
+	/* converts STRING (Latin-1) and COMPOUND_TEXT as well */
+	ret = Xutf8TextPropertyToTextList(karuiwm.dpy, &text_prop, &list, &n);
+	if (ret < Success || n <= 0) {
+		fret = -1;
+		goto get_name_out;
 	}
+	set_name(c, list[0]);
+	XFreeStringList(list);
  get_name_out:
 	XFree(text_prop.value);
 	return fret;
@@ -432,6 +626,28 @@ massacre(struct client *c)
 	XGrabServer(karuiwm.dpy);
 	XSetCloseDownMode(karuiwm.dpy, DestroyAll);
 	XKillClient(karuiwm.dpy, c->win);
-	XSync(karuiwm.dpy, false);
+	(void) ROUNDTRIP(XSync(karuiwm.dpy, false));
 	XUngrabServer(karuiwm.dpy);
 }
+
+static void
+set_name(struct client *c, char const *name)
+{
+	size_t len = strlen(name);
+
+	/* truncate to CLIENT_NAMELEN, without splitting a UTF-8 sequence */
+	if (len >= CLIENT_NAMELEN) {
+		len = CLIENT_NAMELEN - 1;
+		while (len > 0 && ((char unsigned) name[len] & 0xC0) == 0x80)
+			--len;
+	}
+
+	/* the buffer only grows, title changes rarely need to reallocate */
+	if (len + 1 > c->cold->namecap) {
+		c->cold->namecap = MAX(len + 1, 2 * c->cold->namecap);
+		c->cold->name = srealloc(c->cold->name, c->cold->namecap,
+		                         "client name");
+	}
+	memcpy(c->cold->name, name, len);
+	c->cold->name[len] = '\0';
+}
@@ -7,22 +7,36 @@
 #include <X11/Xlib.h>
 #include <stdbool.h>
 
-#define CLIENT_NAMELEN 512
+#define CLIENT_NAMELEN 512 /* bytes, including the terminating '\0' */
 
 enum client_state { STATE_NORMAL, STATE_FULLSCREEN, STATE_SCRATCHPAD };
 
+/* data not needed for arranging (size hints only apply to floating clients) */
+struct client_cold {
+	char *name; /* UTF-8 */
+	size_t namecap;
+	char *class; /* WM_CLASS res_class, NULL if not set */
+	struct process *process; /* NULL if unknown or remote */
+	int freeze; /* per class: 1 always, 0 never, -1 as the desktop */
+	int unsigned basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	size_t nsup;
+	Atom *supported;
+	size_t nnetstate;
+	Atom *netstate; /* _NET_WM_STATE atoms other than FULLSCREEN and HIDDEN */
+};
+
 struct client {
 	struct client *prev, *next; /* list.h */
 	struct desktop *desktop;
+	Window win;
 	int x, y, floatx, floaty;
 	int unsigned w, h, floatw, floath, border;
-	char name[CLIENT_NAMELEN];
-	Window win;
-	bool floating, dialog, visible, transient;
 	enum client_state state;
-	int unsigned basew, baseh, incw, inch, maxw, maxh, minw, minh;
-	size_t nsup;
-	Atom *supported;
+	bool floating, dialog, visible, transient;
+	bool focused; /* border has the focus colour */
+	bool park, parked; /* move off-screen instead of unmapping, see README */
+	char unsigned published; /* last published window state, see client.c */
+	struct client_cold *cold;
 };
 
 void client_delete(struct client *);
@@ -31,11 +45,14 @@ void client_kill(struct client *c);
 void client_move(struct client *c, int x, int y);
 void client_moveresize(struct client *c, int x, int y, int unsigned w, int unsigned h);
 struct client *client_new(Window win);
+void client_publish_state(struct client *c);
 Atom client_query_atom(struct client *c, Atom property);
+void client_query_class(struct client *c);
 void client_query_dialog(struct client *c);
 void client_query_dimension(struct client *c);
 void client_query_fullscreen(struct client *);
 void client_query_name(struct client *c);
+void client_query_process(struct client *c);
 void client_query_sizehints(struct client *c);
 void client_query_supported_atoms(struct client *c);
 void client_query_transient(struct client *c);
@@ -48,5 +65,6 @@ void client_set_focus(struct client *c, bool focus);
 void client_set_fullscreen(struct client *c, bool fullscreen);
 void client_set_visibility(struct client *c, bool visible);
 bool client_supports_atom(struct client *c, Atom atom);
+void client_unpark(struct client *c);
 
 #endif /* ndef _KARUIWM_CLIENT_H */
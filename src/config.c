@@ -3,6 +3,7 @@
 #include "list.h"
 #include "karuiwm.h"
 #include "util.h"
+#include "stats.h"
 #include "string.h"
 #include "strings.h"
 #include "keybind.h"
@@ -44,7 +45,8 @@ config_get_colour(char const *key, uint32_t def, uint32_t *ret)
 		*ret = def;
 		return -1;
 	}
-	if (!XAllocNamedColor(karuiwm.dpy,karuiwm.cm, str, &xcolour,&xcolour)) {
+	if (!ROUNDTRIP(XAllocNamedColor(karuiwm.dpy, karuiwm.cm, str,
+	                                &xcolour, &xcolour))) {
 		WARN("X resources: %s: expected colour code, found `%s`",
 		     key, str);
 		return -1;
@@ -143,7 +145,22 @@ void
 config_term(void)
 {
 	struct xresource *xr;
+	struct buttonbind *bb;
+	struct keybind *kb;
 
+	/* bindings refer to actions, delete them first */
+	while (config.nbuttonbinds > 0) {
+		bb = config.buttonbinds;
+		LIST_REMOVE(&config.buttonbinds, bb);
+		--config.nbuttonbinds;
+		buttonbind_delete(bb);
+	}
+	while (config.nkeybinds > 0) {
+		kb = config.keybinds;
+		LIST_REMOVE(&config.keybinds, kb);
+		--config.nkeybinds;
+		keybind_delete(kb);
+	}
 	while (nxresources > 0) {
 		xr = xresources;
 		LIST_REMOVE(&xresources, xr);
@@ -254,6 +271,16 @@ init_default(void)
 	(void) config_get_colour("border.colour", 0x222222, &config.border.colour);
 	(void) config_get_colour("border.colour_focus", 0x00FF00, &config.border.colour_focus);
 	(void) config_get_int("border.width", 1, (int signed *) &config.border.width);
+	(void) config_get_bool("desktop.grab", false, &config.desktop.grab);
+	(void) config_get_bool("desktop.park", false, &config.desktop.park);
+	(void) config_get_bool("desktop.freeze", false, &config.desktop.freeze);
+	(void) config_get_bool("freeze.enable", false, &config.freeze.enable);
+	(void) config_get_int("focus.hover_delay", 0, (int signed *) &config.focus.hover_delay);
+	(void) config_get_bool("focus.activate", false, &config.focus.activate);
+	(void) config_get_int("freeze.delay", 5000, (int signed *) &config.freeze.delay);
+	(void) config_get_bool("priority.enable", false, &config.priority.enable);
+	(void) config_get_int("priority.nice", 10, &config.priority.nice);
+	(void) config_get_int("priority.oom", 500, &config.priority.oom);
 	(void) config_get_string("modifier", "W", modstr, 2);
 	config.modifier = extract_mod(modstr);
 }
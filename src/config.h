@@ -10,6 +10,21 @@ struct {
 		uint32_t colour, colour_focus;
 		int unsigned width;
 	} border;
+	struct {
+		bool grab, park, freeze;
+	} desktop;
+	struct {
+		int unsigned hover_delay; /* ms */
+		bool activate; /* honour _NET_ACTIVE_WINDOW requests */
+	} focus;
+	struct {
+		bool enable;
+		int unsigned delay; /* ms */
+	} freeze;
+	struct {
+		bool enable;
+		int nice, oom; /* added to niceness and oom_score_adj */
+	} priority;
 	int unsigned modifier;
 	struct buttonbind *buttonbinds;
 	size_t nbuttonbinds;
@@ -1,6 +1,7 @@
 #include "cursor.h"
 #include "karuiwm.h"
 #include "util.h"
+#include "stats.h"
 
 #include <stdbool.h>
 
@@ -11,7 +12,7 @@ cursor_delete(struct cursor *cur)
 
 	for (i = 0; i < CURSOR_LAST; ++i)
 		XFreeCursor(karuiwm.dpy, cur->fonts[i]);
-	free(cur);
+	sfree(cur);
 }
 
 struct cursor *
@@ -44,7 +45,8 @@ cursor_get_pos(struct cursor *cur, int *x, int *y)
 	Window w;
 	(void) cur;
 
-	if (!XQueryPointer(karuiwm.dpy, karuiwm.root, &w, &w, x, y, &i, &i, &ui)) {
+	if (!ROUNDTRIP(XQueryPointer(karuiwm.dpy, karuiwm.root, &w, &w, x, y,
+	                             &i, &i, &ui))) {
 		WARN("XQueryPointer() failed");
 		return -1;
 	}
@@ -57,8 +59,8 @@ cursor_set_type(struct cursor *cur, enum cursor_type type)
 	if (type == CURSOR_NORMAL)
 		return XUngrabPointer(karuiwm.dpy, CurrentTime);
 
-	return XGrabPointer(karuiwm.dpy, karuiwm.root, true, MOUSEMASK,
-	                    GrabModeAsync, GrabModeAsync, None,
-	                    cur->fonts[type], CurrentTime)
+	return ROUNDTRIP(XGrabPointer(karuiwm.dpy, karuiwm.root, true,
+	                              MOUSEMASK, GrabModeAsync, GrabModeAsync,
+	                              None, cur->fonts[type], CurrentTime))
 	       == GrabSuccess;
 }
@@ -1,49 +1,43 @@
 #include "desktop.h"
+#include "config.h"
 #include "util.h"
 #include "list.h"
 #include "layout.h"
+#include "stats.h"
+#include "trace.h"
+#include "probe.h"
+#include "tombstone.h"
 
+static void arrange(struct desktop *d);
 static struct client *get_head(struct desktop *d, struct client *c);
 static struct client *get_last(struct desktop *d, struct client *c);
 static struct client *get_neighbour(struct client *c, enum list_direction dir);
+static void hover(void *arg);
+static void publish_state(struct desktop *d);
+static void set_visibility(struct desktop *d, bool visible);
+
+static struct slab desktop_slab = SLAB_INIT("desktop", struct desktop);
 
 void
 desktop_arrange(struct desktop *d)
 {
-	int unsigned i, is = 0;
-	struct client *c;
-	Window stack[d->nt + d->nf];
-
-	if (d->tiled == NULL && d->floating == NULL)
-		return;
-
-	desktop_set_clientmask(d, 0);
-
-	/* fullscreen windows on top */
-	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next)
-		if (c->state == STATE_FULLSCREEN)
-			stack[is++] = c->win;
-	for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
-		if (c->state == STATE_FULLSCREEN)
-			stack[is++] = c->win;
-
-	/* non-fullscreen windows below */
-	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next) {
-		client_moveresize(c, c->floatx, c->floaty, c->floatw, c->floath);
-		if (c->state != STATE_FULLSCREEN)
-			stack[is++] = c->win;
+	struct client *c = d->hover.armed ? d->hovercli : NULL;
+	int x = 0, y = 0;
+	int unsigned w = 0, h = 0;
+
+	if (c != NULL) {
+		x = c->x;
+		y = c->y;
+		w = c->w;
+		h = c->h;
 	}
-	if (d->nt > 0) {
-		/* FIXME strut (left, right, bottom, top) != 0 break this */
-		d->sellayout->apply(d->tiled, d->nt, MIN(d->nmaster, d->nt),
-		                    d->mfact, d->monitor->x, d->monitor->y,
-		                    d->monitor->w, d->monitor->h);
-		for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
-			if (c->state != STATE_FULLSCREEN)
-				stack[is++] = c->win;
-	}
-	XRestackWindows(karuiwm.dpy, stack, (int signed) (d->nt + d->nf));
+	desktop_set_clientmask(d, 0);
+	arrange(d);
 	desktop_set_clientmask(d, CLIENTMASK);
+
+	/* the pointer may no longer be over the hovered client if it moved */
+	if (c != NULL && (c->x != x || c->y != y || c->w != w || c->h != h))
+		timer_cancel(&d->hover);
 }
 
 void
@@ -71,15 +65,18 @@ desktop_delete(struct desktop *d)
 		while (d->nt > 0) {
 			c = d->tiled;
 			desktop_detach_client(d, c);
+			client_unpark(c);
 			client_delete(c);
 		}
 		while (d->nf > 0) {
 			c = d->floating;
 			desktop_detach_client(d, c);
+			client_unpark(c);
 			client_delete(c);
 		}
 	}
-	free(d);
+	timer_cancel(&d->hover);
+	slab_free(&desktop_slab, d);
 }
 
 void
@@ -93,6 +90,10 @@ desktop_detach_client(struct desktop *d, struct client *c)
 	if (next == c)
 		next = c->floating ? d->tiled : d->floating;
 	d->selcli = next;
+	if (d->focuscli == c)
+		d->focuscli = NULL;
+	if (d->hovercli == c)
+		timer_cancel(&d->hover);
 
 	/* detach */
 	if (c->floating) {
@@ -117,6 +118,7 @@ desktop_float_client(struct desktop *d, struct client *c, bool floating)
 void
 desktop_focus_client(struct desktop *d, struct client *c)
 {
+	timer_cancel(&d->hover);
 	d->selcli = c;
 	desktop_update_focus(d);
 }
@@ -127,6 +129,24 @@ desktop_fullscreen_client(struct desktop *d, struct client *c, bool fullscreen)
 	(void) d;
 
 	client_set_fullscreen(c, fullscreen);
+	client_publish_state(c);
+}
+
+void
+desktop_hover_client(struct desktop *d, struct client *c)
+{
+	if (c == NULL) {
+		timer_cancel(&d->hover);
+		return;
+	}
+	if (config.focus.hover_delay == 0) {
+		desktop_focus_client(d, c);
+		return;
+	}
+
+	/* focus where the pointer settles, not every window it crosses */
+	d->hovercli = c;
+	timer_arm(&d->hover, (uint64_t) config.focus.hover_delay * 1000000);
 }
 
 void
@@ -166,14 +186,17 @@ desktop_new(void)
 	struct desktop *d = NULL;
 
 	/* initialise desktop with default values */
-	d = smalloc(sizeof(struct desktop), "desktop");
+	d = slab_alloc(&desktop_slab);
 	d->mfact = 0.5;
 	d->nmaster = 1;
 	d->nt = d->nf = 0;
 	d->tiled = d->floating = NULL;
-	d->selcli = NULL;
+	d->selcli = d->focuscli = d->hovercli = NULL;
+	d->hover = (struct timer) TIMER_INIT(hover, d);
 	d->sellayout = layouts;
 	d->focus = false;
+	d->park = config.desktop.park;
+	d->freeze = config.desktop.freeze;
 	d->workspace = NULL;
 	d->monitor = NULL;
 	return d;
@@ -187,10 +210,11 @@ desktop_set_clientmask(struct desktop *d, long mask)
 
 	/* TODO move XSelectInput to client */
 	for (i = 0, it = d->tiled; i < d->nt; ++i, it = it->next)
-		XSelectInput(karuiwm.dpy, it->win, mask);
+		if (!tombstone_check(it->win))
+			XSelectInput(karuiwm.dpy, it->win, mask);
 	for (i = 0, it = d->floating; i < d->nf; ++i, it = it->next)
-		XSelectInput(karuiwm.dpy, it->win, mask);
-	XSync(karuiwm.dpy, karuiwm.screen);
+		if (!tombstone_check(it->win))
+			XSelectInput(karuiwm.dpy, it->win, mask);
 }
 
 void
@@ -227,19 +251,7 @@ desktop_shift_client(struct desktop *d, int dir)
 void
 desktop_show(struct desktop *d, struct monitor *m)
 {
-	int unsigned i;
-	struct client *c;
-	bool visible = m != NULL;
-	d->monitor = m;
-
-	desktop_set_clientmask(d, 0);
-	for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
-		client_set_visibility(c, visible);
-	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next)
-		client_set_visibility(c, visible);
-	desktop_set_clientmask(d, CLIENTMASK);
-	if (visible)
-		desktop_arrange(d);
+	desktop_switch(d, m, NULL, NULL);
 }
 
 void
@@ -257,21 +269,66 @@ desktop_step_layout(struct desktop *d, enum list_direction dir)
 	d->sellayout = (dir == PREV) ? d->sellayout->prev : d->sellayout->next;
 }
 
+void
+desktop_switch(struct desktop *in, struct monitor *m,
+               struct desktop *out, struct monitor *othermon)
+{
+	struct desktop *ds[2] = { in, out };
+	size_t i, n = out == NULL ? 1 : 2;
+	struct trace_span s;
+
+	in->monitor = m;
+	if (out != NULL)
+		out->monitor = othermon;
+
+	trace_begin(&s, "desktop", "show");
+	trace_value(&s, "clients", (long) (in->nt + in->nf));
+	trace_value(&s, "visible", m != NULL);
+	if (config.desktop.grab)
+		XGrabServer(karuiwm.dpy);
+	for (i = 0; i < n; ++i) {
+		timer_cancel(&ds[i]->hover);
+		desktop_set_clientmask(ds[i], 0);
+	}
+
+	/* configure the incoming windows while they are still unmapped, then
+	 * map and unmap everything in one batch */
+	for (i = 0; i < n; ++i)
+		if (ds[i]->monitor != NULL)
+			arrange(ds[i]);
+	for (i = 0; i < n; ++i)
+		set_visibility(ds[i], ds[i]->monitor != NULL);
+
+	/* tell clients they are iconic (or no longer), after the windows
+	 * themselves have changed */
+	for (i = 0; i < n; ++i)
+		publish_state(ds[i]);
+
+	for (i = 0; i < n; ++i)
+		desktop_set_clientmask(ds[i], CLIENTMASK);
+	if (config.desktop.grab)
+		XUngrabServer(karuiwm.dpy);
+	trace_end(&s);
+}
+
 void
 desktop_update_focus(struct desktop *d)
 {
-	int unsigned i;
-	struct client *c;
+	struct client *c = d->focus ? d->selcli : NULL;
 
 	if (d->nt + d->nf == 0) {
+		d->focuscli = NULL;
 		XSetInputFocus(karuiwm.dpy, karuiwm.root, RevertToPointerRoot,
 		               CurrentTime);
 		return;
 	}
-	for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
-		client_set_focus(c, d->focus && c == d->selcli);
-	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next)
-		client_set_focus(c, d->focus && c == d->selcli);
+
+	/* only the previously and the newly focused client change */
+	if (d->focuscli != NULL && d->focuscli != c)
+		client_set_focus(d->focuscli, false);
+	if (c != NULL)
+		client_set_focus(c, true);
+	d->focuscli = c;
 }
 
 void
@@ -293,7 +350,57 @@ desktop_zoom(struct desktop *d)
 	}
 }
 
-inline static struct client *
+inline static void
+arrange(struct desktop *d)
+{
+	int unsigned i, is = 0;
+	struct client *c;
+	struct stats_timer t;
+	struct trace_span s, sl;
+	Window stack[d->nt + d->nf];
+
+	if (d->tiled == NULL && d->floating == NULL)
+		return;
+
+	PROBE2(arrange_begin, d->nt, d->nf);
+	trace_begin(&s, "desktop", "arrange");
+	trace_value(&s, "nt", (long) d->nt);
+	trace_value(&s, "nf", (long) d->nf);
+	stats_start(&t, &stats.arrange);
+
+	/* fullscreen windows on top */
+	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next)
+		if (c->state == STATE_FULLSCREEN)
+			stack[is++] = c->win;
+	for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
+		if (c->state == STATE_FULLSCREEN)
+			stack[is++] = c->win;
+
+	/* non-fullscreen windows below */
+	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next) {
+		client_moveresize(c, c->floatx, c->floaty, c->floatw, c->floath);
+		if (c->state != STATE_FULLSCREEN)
+			stack[is++] = c->win;
+	}
+	if (d->nt > 0) {
+		/* FIXME strut (left, right, bottom, top) != 0 break this */
+		trace_begin(&sl, "layout", d->sellayout->name);
+		trace_value(&sl, "nt", (long) d->nt);
+		d->sellayout->apply(d->tiled, d->nt, MIN(d->nmaster, d->nt),
+		                    d->mfact, d->monitor->x, d->monitor->y,
+		                    d->monitor->w, d->monitor->h);
+		trace_end(&sl);
+		for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
+			if (c->state != STATE_FULLSCREEN)
+				stack[is++] = c->win;
+	}
+	XRestackWindows(karuiwm.dpy, stack, (int signed) (d->nt + d->nf));
+	stats_stop(&t);
+	trace_end(&s);
+	PROBE2(arrange_end, d->nt, d->nf);
+}
+
+static struct client *
 get_head(struct desktop *d, struct client *c)
 {
 	if (c == NULL)
@@ -317,3 +424,35 @@ get_neighbour(struct client *c, enum list_direction dir)
 {
 	return c == NULL ? NULL : (dir == PREV) ? c->prev : c->next;
 }
+
+static void
+hover(void *arg)
+{
+	struct desktop *d = arg;
+
+	desktop_focus_client(d, d->hovercli);
+}
+
+static void
+publish_state(struct desktop *d)
+{
+	int unsigned i;
+	struct client *c;
+
+	for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
+		client_publish_state(c);
+	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next)
+		client_publish_state(c);
+}
+
+static void
+set_visibility(struct desktop *d, bool visible)
+{
+	int unsigned i;
+	struct client *c;
+
+	for (i = 0, c = d->tiled; i < d->nt; ++i, c = c->next)
+		client_set_visibility(c, visible);
+	for (i = 0, c = d->floating; i < d->nf; ++i, c = c->next)
+		client_set_visibility(c, visible);
+}
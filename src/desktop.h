@@ -5,19 +5,24 @@
 #include "workspace.h"
 #include "monitor.h"
 #include "argument.h"
+#include "timer.h"
 #include <stdbool.h>
 
 struct desktop {
 	struct desktop *prev, *next; /* list.h */
+	struct desktop *gridnext; /* hash chain, see workspace.c */
 	struct workspace *workspace;
 	struct monitor *monitor;
 	size_t nt, nf, nmaster;
 	struct client *tiled, *floating, *selcli;
+	struct client *focuscli; /* drawn as focused, see desktop_update_focus */
+	struct client *hovercli; /* to be focused, see desktop_hover_client */
+	struct timer hover;
 	struct workspace *ws;
 	struct layout *sellayout;
 	float mfact;
 	int posx, posy;
-	bool focus;
+	bool focus, park, freeze;
 };
 
 void desktop_arrange(struct desktop *d);
@@ -28,6 +33,7 @@ void desktop_float_client(struct desktop *d, struct client *c, bool floating);
 void desktop_focus_client(struct desktop *d, struct client *c);
 void desktop_fullscreen_client(struct desktop *d, struct client *c,
                                bool fullscreen);
+void desktop_hover_client(struct desktop *d, struct client *c);
 void desktop_kill_client(struct desktop *d);
 int desktop_locate_window(struct desktop *d, struct client **c, Window win);
 struct desktop *desktop_new(void);
@@ -39,6 +45,8 @@ void desktop_shift_client(struct desktop *d, int dir);
 void desktop_show(struct desktop *d, struct monitor *m);
 void desktop_step_client(struct desktop *d, enum list_direction dir);
 void desktop_step_layout(struct desktop *d, enum list_direction dir);
+void desktop_switch(struct desktop *in, struct monitor *m,
+                    struct desktop *out, struct monitor *othermon);
 void desktop_update_focus(struct desktop *d);
 void desktop_zoom(struct desktop *d);
 
@@ -10,6 +10,8 @@ struct subscription {
 static struct subscription *findsub(void (*event_handler)(union event *ev),
                                     enum event_type type);
 
+static struct slab subscription_slab = SLAB_INIT("subscription",
+                                                 struct subscription);
 static struct subscription *subs[EVENT_LAST] = { NULL };
 static size_t nsubs[EVENT_LAST] = { 0 };
 
@@ -26,14 +28,14 @@ event_set_subscription(enum event_type type,
 
 	s = findsub(event_handler, type);
 	if (subscribe && s == NULL) {
-		s = smalloc(sizeof(struct subscription), "subscription");
+		s = slab_alloc(&subscription_slab);
 		s->event_handler = event_handler;
 		LIST_APPEND(subs[type], s);
 		++nsubs[type];
 	} else if (!subscribe && s != NULL) {
 		LIST_REMOVE(subs[type], s);
 		--nsubs[type];
-		sfree(s);
+		slab_free(&subscription_slab, s);
 	}
 }
 
@@ -1,6 +1,7 @@
 #include "focus.h"
 #include "util.h"
 #include "list.h"
+#include "stats.h"
 #ifdef XINERAMA
 # include <X11/extensions/Xinerama.h>
 #endif
@@ -58,6 +59,31 @@ focus_detach_monitor(struct focus *f, struct monitor *m)
 		f->selmon = f->nmon > 0 ? f->monitors : NULL;
 }
 
+int
+focus_locate_monitor(struct focus *f, struct monitor **m, Window win)
+{
+	int unsigned i;
+	struct monitor *it;
+
+	for (i = 0, it = f->monitors; i < f->nmon; ++i, it = it->next) {
+		if (it->input == win) {
+			*m = it;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+void
+focus_lower_inputs(struct focus *f)
+{
+	int unsigned i;
+	struct monitor *m;
+
+	for (i = 0, m = f->monitors; i < f->nmon; ++i, m = m->next)
+		XLowerWindow(karuiwm.dpy, m->input);
+}
+
 void
 focus_monitor_by_mouse(struct focus *f, int x, int y)
 {
@@ -101,7 +127,7 @@ focus_scan_monitors(struct focus *f)
 	struct monitor *m;
 
 #ifdef XINERAMA
-	if (XineramaIsActive(karuiwm.dpy)) {
+	if (ROUNDTRIP(XineramaIsActive(karuiwm.dpy))) {
 		scan_xinerama(f);
 		return;
 	}
@@ -160,7 +186,7 @@ scan_xinerama(struct focus *f)
 	XineramaScreenInfo *raw_info, *info;
 
 	/* get screen information */
-	raw_info = XineramaQueryScreens(karuiwm.dpy, (int *) &raw_n);
+	raw_info = ROUNDTRIP(XineramaQueryScreens(karuiwm.dpy, (int *) &raw_n));
 
 	/* de-duplicate screen information: O(n²) */
 	info = scalloc(raw_n, sizeof(XineramaScreenInfo),
@@ -208,7 +234,7 @@ scan_xinerama(struct focus *f)
 	}
 	monitor_focus(f->monitors, true);
 
-	XFree(info);
-	XSync(karuiwm.dpy, karuiwm.screen);
+	sfree(info);
+	(void) ROUNDTRIP(XSync(karuiwm.dpy, karuiwm.screen));
 }
 #endif /* def XINERAMA */
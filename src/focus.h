@@ -14,6 +14,8 @@ void focus_associate_client(struct focus *f, struct client *c);
 void focus_attach_monitor(struct focus *f, struct monitor *m);
 void focus_delete(struct focus *f);
 void focus_detach_monitor(struct focus *f, struct monitor *m);
+int focus_locate_monitor(struct focus *f, struct monitor **m, Window win);
+void focus_lower_inputs(struct focus *f);
 void focus_monitor_by_mouse(struct focus *f, int x, int y);
 void focus_monitor(struct focus *f, struct monitor *m);
 struct focus *focus_new(struct session *s);
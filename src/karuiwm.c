@@ -15,6 +15,17 @@
 #include "argument.h"
 #include "keybind.h"
 #include "buttonbind.h"
+#include "stats.h"
+#include "trace.h"
+#include "probe.h"
+#include "watchdog.h"
+#include "record.h"
+#include "log.h"
+#include "timer.h"
+#include "tombstone.h"
+#include "xerror.h"
+#include "process.h"
+#include "steal.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -25,6 +36,7 @@
 #include <locale.h>
 #include <signal.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <sys/wait.h>
 #include <sys/select.h>
 #include <X11/Xatom.h>
@@ -33,10 +45,11 @@
 #include <X11/Xproto.h>
 
 /* macros */
-#define _INIT_ATOM(D, L, A) L[A] = XInternAtom(D, #A, False)
+#define _INIT_ATOM(D, L, A) L[A] = ROUNDTRIP(XInternAtom(D, #A, False))
 #define BUFSIZE 1024
 
 /* functions */
+static void action_dumpstats(union argument *arg);
 static void action_killclient(union argument *arg);
 static void action_mousemove(union argument *arg);
 static void action_mouseresize(union argument *arg);
@@ -50,8 +63,13 @@ static void action_stepdesktop(union argument *arg);
 static void action_steplayout(union argument *arg);
 static void action_stop(union argument *arg);
 static void action_togglefloat(union argument *arg);
+static void action_togglefreeze(union argument *arg);
+static void action_togglepark(union argument *arg);
 static void action_zoom(union argument *arg);
+static void activate_client(struct client *c);
 static void check_restart(char **argv);
+static void dispatch(XEvent *xe);
+static void dump_stats(void);
 static void grabkeys(void);
 static void handle_buttonpress(XEvent *xe);
 static void handle_clientmessage(XEvent *xe);
@@ -66,15 +84,21 @@ static void handle_mappingnotify(XEvent *xe);
 static void handle_maprequest(XEvent *xe);
 static void handle_propertynotify(XEvent *xe);
 static int handle_xerror(Display *dpy, XErrorEvent *xe);
+static int handle_xioerror(Display *dpy);
 static void init(void);
 static void init_actions(void);
 static void init_atoms(void);
+static void mouse_event(long mask, XEvent *ev);
 static void mouse_move(struct client *c, int mx, int my);
 static void mouse_moveresize(struct client *c, void (*mh)(struct client *, int, int));
 static void mouse_resize(struct client *c, int mx, int my);
 static void parse_args(int argc, char **argv);
+static void replay(char const *path);
+static int replay_ahead(size_t n);
+static int replay_read(XEvent *xe);
 static void run(void);
 static void sigchld(int);
+static void sigusr1(int);
 static void term(void);
 
 /* event handlers, as array to allow O(1) access; numeric codes are in X.h */
@@ -93,8 +117,29 @@ static void (*handle[LASTEvent])(XEvent *) = {
 	[PropertyNotify]   = handle_propertynotify,   /*28*/
 };
 static int (*xerrorxlib)(Display *dpy, XErrorEvent *xe);
+static volatile sig_atomic_t dumpstats;
+static char const *replayfile;
+static FILE *replaying; /* recording being replayed */
+static struct {
+	struct {
+		XEvent xe;
+		uint32_t lookahead;
+	} *events;
+	size_t first, n, size;
+} ahead; /* read from the recording, not yet replayed */
+static uint64_t nreplayed;
+static bool alloccheck;
+static uint64_t allocfailures;
 
 /* implementation */
+static void
+action_dumpstats(union argument *arg)
+{
+	(void) arg;
+
+	dump_stats();
+}
+
 static void
 action_killclient(union argument *arg)
 {
@@ -112,7 +157,8 @@ action_mousemove(union argument *arg)
 	//EVENT("movemouse(%lu)", c->win);
 
 	if (session_locate_window(karuiwm.session, &c, win) < 0) {
-		WARN("attempt to mouse-move unhandled window %lu", win);
+		WARN_LIMIT("attempt to mouse-move unhandled window %lu",
+		           win);
 		return;
 	}
 	mouse_moveresize(karuiwm.focus->selmon->seldt->selcli, mouse_move);
@@ -127,7 +173,8 @@ action_mouseresize(union argument *arg)
 	//EVENT("resizemouse(%lu)", c->win);
 
 	if (session_locate_window(karuiwm.session, &c, win) < 0) {
-		WARN("attempt to mouse-resize unhandled window %lu", win);
+		WARN_LIMIT("attempt to mouse-resize unhandled window %lu",
+		           win);
 		return;
 	}
 	mouse_moveresize(c, mouse_resize);
@@ -228,6 +275,26 @@ action_togglefloat(union argument *arg)
 	desktop_arrange(d);
 }
 
+static void
+action_togglefreeze(union argument *arg)
+{
+	struct desktop *d = karuiwm.focus->selmon->seldt;
+	(void) arg;
+
+	/* takes effect the next time the desktop is hidden */
+	d->freeze = !d->freeze;
+}
+
+static void
+action_togglepark(union argument *arg)
+{
+	struct desktop *d = karuiwm.focus->selmon->seldt;
+	(void) arg;
+
+	/* takes effect the next time the desktop is hidden */
+	d->park = !d->park;
+}
+
 static void
 action_zoom(union argument *arg)
 {
@@ -238,6 +305,21 @@ action_zoom(union argument *arg)
 	desktop_arrange(d);
 }
 
+static void
+activate_client(struct client *c)
+{
+	struct desktop *d = c->desktop;
+	struct focus *f = karuiwm.focus;
+
+	/* windows on hidden desktops are not brought forward */
+	steal_activation();
+	if (d->monitor == NULL)
+		return;
+	if (d->monitor != f->selmon)
+		focus_monitor(f, d->monitor);
+	desktop_focus_client(d, c);
+}
+
 static void
 check_restart(char **argv)
 {
@@ -250,6 +332,56 @@ check_restart(char **argv)
 	}
 }
 
+static void
+dump_stats(void)
+{
+	char path[BUFSIZE];
+	FILE *f;
+
+	if (config_get_string("stats.file", NULL, path, BUFSIZE) < 0) {
+		stats_dump(stdout);
+		return;
+	}
+	f = fopen(path, "a");
+	if (f == NULL) {
+		WARN("could not open %s for statistics: %s",
+		     path, strerror(errno));
+		return;
+	}
+	stats_dump(f);
+	(void) fclose(f);
+}
+
+static void
+dispatch(XEvent *xe)
+{
+	struct stats_timer t;
+	struct trace_span s;
+	uint64_t allocs;
+
+	if (handle[xe->type] == NULL)
+		return;
+	allocs = alloc_total();
+	trace_begin(&s, "event", stats_event_name(xe->type));
+	trace_window(&s, xe->xany.window);
+	PROBE2(event_begin, xe->type, xe->xany.window);
+	watchdog_enter(xe->type, xe->xany.window);
+	stats_start(&t, &stats.events[xe->type]);
+	handle[xe->type](xe);
+	stats_stop(&t);
+	watchdog_leave();
+	PROBE2(event_end, xe->type, xe->xany.window);
+	trace_end(&s);
+
+	/* in steady state, only new windows should need memory */
+	allocs = alloc_total() - allocs;
+	if (alloccheck && allocs > 0 && xe->type != MapRequest) {
+		ERROR("%s on window %lu made %"PRIu64" allocations",
+		      stats_event_name(xe->type), xe->xany.window, allocs);
+		++allocfailures;
+	}
+}
+
 static void
 grabkeys(void)
 {
@@ -280,7 +412,8 @@ handle_buttonpress(XEvent *xe)
 	for (i = 0, bb = config.buttonbinds; i < config.nbuttonbinds;
 	     ++i, bb = bb->next) {
 		if (bb->mod == e->state && bb->button == e->button) {
-			bb->action->function(&((union argument) {.v = &e->window}));
+			action_invoke(bb->action,
+			              &((union argument) {.v = &e->window}));
 			break;
 		}
 	}
@@ -297,8 +430,13 @@ handle_clientmessage(XEvent *xe)
 
 	if (session_locate_window(karuiwm.session, &c, e->window) < 0)
 		return;
+	if (e->message_type == netatoms[_NET_ACTIVE_WINDOW]
+	&& config.focus.activate) {
+		activate_client(c);
+		return;
+	}
 	if (e->message_type != netatoms[_NET_WM_STATE]) {
-		WARN("received client message for other than WM state");
+		WARN_LIMIT("received client message for other than WM state");
 		return;
 	}
 	if ((Atom) e->data.l[1] == netatoms[_NET_WM_STATE_FULLSCREEN]
@@ -315,22 +453,37 @@ handle_clientmessage(XEvent *xe)
 static void
 handle_configurenotify(XEvent *xe)
 {
+	struct monitor *m;
 	XConfigureEvent *e = &xe->xconfigure;
 
 	//EVENT("configurenotify(%lu)", e->window);
 
-	if (e->window == karuiwm.root)
+	if (e->window == karuiwm.root) {
 		focus_scan_monitors(karuiwm.focus);
+		return;
+	}
+
+	/* a window restacked to the bottom (Below, BottomIf, or lowered by
+	 * its client) would be covered by the monitors' input windows */
+	if (e->event == karuiwm.root && e->above == None
+	&& focus_locate_monitor(karuiwm.focus, &m, e->window) < 0)
+		focus_lower_inputs(karuiwm.focus);
 }
 
 static void
 handle_configurerequest(XEvent *xe)
 {
 	XWindowChanges wc;
+	struct client *c;
 	XConfigureRequestEvent *e = &xe->xconfigurerequest;
 
 	//EVENT("configurerequest(%lu)", e->window);
 
+	/* parked windows stay off-screen until their desktop is shown */
+	if (session_locate_window(karuiwm.session, &c, e->window) == 0
+	&& c->parked)
+		e->value_mask &= ~(long unsigned) (CWX | CWY);
+
 	/* TODO if dimensions match screen dimensions, fullscreen (mplayer) */
 
 	wc.x = e->x;
@@ -370,19 +523,32 @@ static void
 handle_enternotify(XEvent *xe)
 {
 	struct client *c;
+	struct monitor *m;
+	struct focus *f = karuiwm.focus;
 	XEnterWindowEvent *e = &xe->xcrossing;
 
 	//EVENT("enternotify(%lu)", e->window);
 
+	/* the monitor follows the pointer */
+	if (focus_locate_monitor(f, &m, e->window) == 0) {
+		if (m != f->selmon)
+			focus_monitor(f, m);
+		return;
+	}
 	if (session_locate_window(karuiwm.session, &c, e->window) < 0) {
-		WARN("entering unhandled window %lu", e->window);
+		WARN_LIMIT("entering unhandled window %lu", e->window);
 		return;
 	}
+	m = c->desktop->monitor;
+	if (m != NULL && m != f->selmon)
+		focus_monitor(f, m);
 	if (c->desktop->selcli == c && e->focus) {
-		/* ignore event for windows that already have focus */
+		/* ignore event for windows that already have focus, but
+		 * forget about the windows crossed on the way back */
+		desktop_hover_client(c->desktop, NULL);
 		return;
 	}
-	desktop_focus_client(c->desktop, c);
+	desktop_hover_client(c->desktop, c);
 }
 
 static void
@@ -408,8 +574,11 @@ handle_focusin(XEvent *xe)
 	if (e->window == karuiwm.root)
 		return;
 	if (selcli == NULL || e->window != selcli->win) {
-		WARN("attempt to steal focus by window %lu (focus is on %lu)",
-		     e->window, selcli == NULL ? 0 : selcli->win);
+		if (!steal_record(e->window))
+			return;
+		WARN_LIMIT("attempt to steal focus by window %lu "
+		           "(focus is on %lu)", e->window,
+		           selcli == NULL ? 0 : selcli->win);
 		desktop_focus_client(seldt, selcli);
 	}
 }
@@ -427,7 +596,7 @@ handle_keypress(XEvent *xe)
 	for (i = 0, kb = config.keybinds; i < config.nkeybinds;
 	     ++i, kb = kb->next) {
 		if (e->state == kb->mod && keysym == kb->key) {
-			kb->action->function(&kb->arg);
+			action_invoke(kb->action, &kb->arg);
 			break;
 		}
 	}
@@ -441,7 +610,8 @@ handle_mappingnotify(XEvent *xe)
 	//EVENT("mappingnotify(%lu)", e->window);
 
 	/* TODO handle keyboard mapping changes */
-	WARN("keyboard mapping not implemented (window %lu)", e->window);
+	WARN_LIMIT("keyboard mapping not implemented (window %lu)",
+	           e->window);
 }
 
 static void
@@ -472,7 +642,8 @@ handle_maprequest(XEvent *xe)
 		                     MIN(c->floatw, d->monitor->w),
 		                     MIN(c->floath, d->monitor->h));
 	desktop_arrange(d);
-	XMapWindow(karuiwm.dpy, c->win);
+	client_set_visibility(c, true);
+	client_publish_state(c);
 	client_grab_buttons(c, config.nbuttonbinds, config.buttonbinds);
 	desktop_focus_client(d, c);
 }
@@ -490,7 +661,8 @@ handle_propertynotify(XEvent *xe)
 
 	if (e->state == PropertyDelete) {
 		/* TODO handle property deletion */
-		WARN("property deletion not implemented (window %lu)", c->win);
+		WARN_LIMIT("property deletion not implemented "
+		           "(window %lu)", c->win);
 		return;
 	}
 
@@ -505,7 +677,8 @@ handle_propertynotify(XEvent *xe)
 		client_query_sizehints(c);
 		break;
 	case XA_WM_HINTS:
-		WARN("urgent hint not implemented (window %lu)", c->win);
+		WARN_LIMIT("urgent hint not implemented (window %lu)",
+		           c->win);
 		/* TODO implement urgent hint handling */
 		break;
 	}
@@ -521,11 +694,9 @@ handle_propertynotify(XEvent *xe)
 static int
 handle_xerror(Display *dpy, XErrorEvent *ee)
 {
-	char es[256];
 	bool ignore;
 
-	XGetErrorText(dpy, ee->error_code, es, 256);
-	ERROR("%s after request %d", es, ee->request_code);
+	xerror_record(ee);
 	ignore = ee->error_code == BadWindow
 	|| (ee->request_code == X_SetInputFocus && ee->error_code == BadMatch);
 
@@ -533,10 +704,21 @@ handle_xerror(Display *dpy, XErrorEvent *ee)
 	return ignore ? 0 : xerrorxlib(dpy, ee);
 }
 
+static int
+handle_xioerror(Display *dpy)
+{
+	(void) dpy;
+
+	/* Xlib would exit() anyway, but say why */
+	FATAL("lost the connection to X");
+}
+
 static void
 init(void)
 {
 	XSetWindowAttributes wa;
+	struct trace_span s;
+	int threshold;
 
 	/* environment */
 	karuiwm.env.HOME = getenv("HOME");
@@ -548,9 +730,13 @@ init(void)
 	if (karuiwm.dpy == NULL)
 		FATAL("could not open X");
 
-	/* errors, zombies, locale */
+	/* errors, zombies, statistics dump, locale */
 	xerrorxlib = XSetErrorHandler(handle_xerror);
+	(void) XSetIOErrorHandler(handle_xioerror);
 	sigchld(0);
+	stats_init();
+	if (signal(SIGUSR1, sigusr1) == SIG_ERR)
+		FATAL("could not install SIGUSR1 handler");
 	if (setlocale(LC_ALL, "") == NULL)
 		FATAL("could not set locale");
 	if (!XSupportsLocale())
@@ -566,15 +752,24 @@ init(void)
 	/* events */
 	wa.event_mask = SubstructureNotifyMask | SubstructureRedirectMask |
 	                PropertyChangeMask | FocusChangeMask | ButtonPressMask |
-	                KeyPressMask | PointerMotionMask | StructureNotifyMask;
+	                KeyPressMask | StructureNotifyMask;
 	XChangeWindowAttributes(karuiwm.dpy, karuiwm.root, CWEventMask, &wa);
 
 	/* actions */
 	init_actions();
 
 	/* user configuration */
+	trace_begin(&s, "config", "load");
 	if (config_init() < 0)
 		FATAL("could not initialise X resources");
+	trace_end(&s);
+
+	/* event loop watchdog */
+	(void) config_get_int("watchdog.threshold", 1000, &threshold);
+	(void) watchdog_init((int unsigned) MAX(threshold, 0));
+
+	/* priorities of hidden processes */
+	process_init();
 
 	/* input (mouse, keyboard) */
 	karuiwm.cursor = cursor_new();
@@ -590,6 +785,7 @@ static void
 init_actions(void)
 {
 	actions = NULL;
+	LIST_APPEND(&actions, action_new("dumpstats",   action_dumpstats,  ARGTYPE_NONE));
 	LIST_APPEND(&actions, action_new("killclient",  action_killclient, ARGTYPE_NONE));
 	LIST_APPEND(&actions, action_new("mousemove",   action_mousemove,  ARGTYPE_NONE));
 	LIST_APPEND(&actions, action_new("mouseresize", action_mouseresize,ARGTYPE_NONE));
@@ -603,6 +799,8 @@ init_actions(void)
 	LIST_APPEND(&actions, action_new("steplayout",  action_steplayout, ARGTYPE_LIST_DIRECTION));
 	LIST_APPEND(&actions, action_new("stop",        action_stop,       ARGTYPE_NONE));
 	LIST_APPEND(&actions, action_new("togglefloat", action_togglefloat,ARGTYPE_NONE));
+	LIST_APPEND(&actions, action_new("togglefreeze",action_togglefreeze,ARGTYPE_NONE));
+	LIST_APPEND(&actions, action_new("togglepark",  action_togglepark, ARGTYPE_NONE));
 	LIST_APPEND(&actions, action_new("zoom",        action_zoom,       ARGTYPE_NONE));
 	nactions = LIST_SIZE(actions);
 }
@@ -617,6 +815,7 @@ init_atoms(void)
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_ACTIVE_WINDOW);
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_SUPPORTED);
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_WM_NAME);
+	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_WM_PID);
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_WM_STATE);
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_WM_STATE_FULLSCREEN);
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_WM_STATE_HIDDEN);
@@ -626,6 +825,24 @@ init_atoms(void)
 	_INIT_ATOM(karuiwm.dpy, netatoms, _NET_WM_STRUT_PARTIAL);
 }
 
+static void
+mouse_event(long mask, XEvent *ev)
+{
+	/* the events of a drag are recorded and replayed in sequence with the
+	 * others, as they bypass the event loop */
+	if (replaying != NULL) {
+		if (replay_read(ev) > 0)
+			return;
+
+		/* the recording ends in the middle of the drag */
+		memset(ev, 0, sizeof(*ev));
+		ev->type = ButtonRelease;
+		return;
+	}
+	XMaskEvent(karuiwm.dpy, mask, ev);
+	record_event(ev, 0);
+}
+
 static void
 mouse_move(struct client *c, int mx, int my)
 {
@@ -638,7 +855,10 @@ mouse_move(struct client *c, int mx, int my)
 	if (cursor_set_type(karuiwm.cursor, CURSOR_MOVE) < 0)
 		WARN("could not change cursor appearance to moving");
 	do {
-		XMaskEvent(karuiwm.dpy, evmask, &ev);
+		/* waiting for the user is not a stall */
+		watchdog_leave();
+		mouse_event(evmask, &ev);
+		watchdog_enter(ev.type, ev.xany.window);
 		switch (ev.type) {
 		case ButtonRelease:
 			break;
@@ -657,7 +877,7 @@ mouse_move(struct client *c, int mx, int my)
 			client_move(c, cx, cy);
 			break;
 		default:
-			WARN("unhandled event %d", ev.type);
+			WARN_LIMIT("unhandled event %d", ev.type);
 		}
 	} while (ev.type != ButtonRelease);
 	if (cursor_set_type(karuiwm.cursor, CURSOR_NORMAL) < 0)
@@ -726,7 +946,10 @@ mouse_resize(struct client *c, int mx, int my)
 	                    /* ignore */      CURSOR_NORMAL) < 0)
 	        WARN("could not change cursor appearance to resizing");
 	do {
-		XMaskEvent(karuiwm.dpy, evmask, &ev);
+		/* waiting for the user is not a stall */
+		watchdog_leave();
+		mouse_event(evmask, &ev);
+		watchdog_enter(ev.type, ev.xany.window);
 		switch (ev.type) {
 		case ButtonRelease:
 			break;
@@ -740,20 +963,20 @@ mouse_resize(struct client *c, int mx, int my)
 			dy = ev.xmotion.y - my;
 
 			/* incremental size */
-			if (c->incw > 0)
-				dx = dx / (int signed) c->incw
-				        * (int signed) c->incw;
-			if (c->inch > 0)
-				dy = dy / (int signed) c->inch
-				        * (int signed) c->inch;
+			if (c->cold->incw > 0)
+				dx = dx / (int signed) c->cold->incw
+				        * (int signed) c->cold->incw;
+			if (c->cold->inch > 0)
+				dy = dy / (int signed) c->cold->inch
+				        * (int signed) c->cold->inch;
 
 			/* minimum size (x) */
 			if (left
-			&& (int signed) cw - dx >= (int signed) c->minw) {
+			&& (int signed) cw - dx >= (int signed) c->cold->minw) {
 				cx += dx;
 				cw = (int unsigned) ((int signed) cw - dx);
 			} else if (right
-			&& (int signed) cw + dx >= (int signed) c->minw) {
+			&& (int signed) cw + dx >= (int signed) c->cold->minw) {
 				cw = (int unsigned) ((int signed) cw + dx);
 			} else {
 				dx = 0;
@@ -761,11 +984,11 @@ mouse_resize(struct client *c, int mx, int my)
 
 			/* minimum size (y) */
 			if (top
-			&& (int signed) ch - dy >= (int signed) c->minh) {
+			&& (int signed) ch - dy >= (int signed) c->cold->minh) {
 				cy += dy;
 				ch = (int unsigned) ((int signed) ch - dy);
 			} else if (bottom
-			&& (int signed) ch + dy >= (int signed) c->minh) {
+			&& (int signed) ch + dy >= (int signed) c->cold->minh) {
 				ch = (int unsigned) ((int signed) ch + dy);
 			} else {
 				dy = 0;
@@ -777,7 +1000,7 @@ mouse_resize(struct client *c, int mx, int my)
 			client_moveresize(c, cx, cy, cw, ch);
 			break;
 		default:
-			WARN("unhandled event %d", ev.type);
+			WARN_LIMIT("unhandled event %d", ev.type);
 		}
 	} while (ev.type != ButtonRelease);
 	if (cursor_set_type(karuiwm.cursor, CURSOR_NORMAL) < 0)
@@ -802,28 +1025,176 @@ parse_args(int argc, char **argv)
 			DEBUG("debug log level");
 		} else if (strcmp(opt, "-q") == 0) {
 			set_log_level(LOG_FATAL);
+		} else if (strcmp(opt, "-t") == 0 && i + 1 < argc) {
+			if (trace_init(argv[++i]) < 0)
+				FATAL("could not initialise tracing");
+		} else if (strcmp(opt, "-r") == 0 && i + 1 < argc) {
+			if (record_init(argv[++i]) < 0)
+				FATAL("could not initialise recording");
+		} else if (strcmp(opt, "-R") == 0 && i + 1 < argc) {
+			replayfile = argv[++i];
+		} else if (strcmp(opt, "-a") == 0) {
+			alloccheck = true;
 		} else {
-			fprintf(stderr, "Usage: %s [-v|-d|-q]",
+			fprintf(stderr, "Usage: %s [-v|-d|-q] [-t FILE] "
+			        "[-r FILE|-R FILE] [-a]",
 			        karuiwm.env.APPNAME);
 			FATAL("Unknown option: %s\n", argv[i]);
 		}
 	}
 }
 
+static void
+replay(char const *path)
+{
+	XEvent xe;
+	int ret = 0;
+	uint64_t cpu;
+	long unsigned requests;
+	struct timespec ts;
+
+	replaying = record_open(path);
+	if (replaying == NULL)
+		FATAL("could not open recording");
+
+	/* replay as fast as possible, ignoring the recorded timing; the
+	 * watchdog thread is not included in the CPU time */
+	requests = NextRequest(karuiwm.dpy);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	cpu = (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+	karuiwm.running = true;
+	while (karuiwm.running && (ret = replay_read(&xe)) > 0) {
+		if (tombstone_filter(&xe))
+			continue;
+		dispatch(&xe);
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	cpu = (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec - cpu;
+	requests = NextRequest(karuiwm.dpy) - requests;
+	if (ret < 0)
+		ERROR("recording %s is truncated", path);
+	(void) fclose(replaying);
+	replaying = NULL;
+	sfree(ahead.events);
+
+	printf("replay events=%"PRIu64" cpu_ns=%"PRIu64" requests=%lu\n",
+	       nreplayed, cpu, requests);
+	dump_stats();
+}
+
+static int
+replay_ahead(size_t n)
+{
+	int ret;
+	uint64_t t;
+	size_t i;
+
+	/* make room for n events from the first one on */
+	if (ahead.first + n > ahead.size) {
+		if (ahead.first > 0) {
+			memmove(ahead.events, ahead.events + ahead.first,
+			        ahead.n * sizeof(*ahead.events));
+			ahead.first = 0;
+		}
+		if (n > ahead.size) {
+			ahead.size = MAX(n, 2 * ahead.size);
+			ahead.events = srealloc(ahead.events, ahead.size
+			                        * sizeof(*ahead.events),
+			                        "replay look-ahead");
+		}
+	}
+	while (ahead.n < n) {
+		i = ahead.first + ahead.n;
+		ret = record_read(replaying, &ahead.events[i].xe, &t,
+		                  &ahead.events[i].lookahead);
+		if (ret <= 0)
+			return ret;
+		++ahead.n;
+	}
+	return 1;
+}
+
+static int
+replay_read(XEvent *xe)
+{
+	int ret;
+	size_t i;
+	uint32_t lookahead;
+
+	ret = replay_ahead(1);
+	if (ret <= 0)
+		return ret;
+	*xe = ahead.events[ahead.first].xe;
+	lookahead = ahead.events[ahead.first].lookahead;
+	++ahead.first;
+	--ahead.n;
+	++nreplayed;
+
+	/* scan the events the recorded run had queued, as run() does; a
+	 * truncated recording is reported when its end is read */
+	if (lookahead > 0) {
+		(void) replay_ahead(lookahead);
+		for (i = 0; i < MIN(lookahead, ahead.n); ++i)
+			tombstone_scan_event(&ahead.events[ahead.first + i].xe);
+	}
+	return 1;
+}
+
 static void
 run(void)
 {
 	XEvent xe;
+	fd_set fds;
+	struct timeval tv;
+	uint64_t timeout;
+	int queued = 0; /* events in the queue after the last scan */
+	uint32_t scanned;
 
 	karuiwm.running = true;
 	while (karuiwm.running) {
+		if (dumpstats) {
+			dumpstats = 0;
+			dump_stats();
+		}
+		timer_run();
+
+		/* wait for X, a signal (XNextEvent() would not return) or the
+		 * next timer */
+		if (XPending(karuiwm.dpy) == 0) {
+			trace_flush();
+			FD_ZERO(&fds);
+			FD_SET(karuiwm.xfd, &fds);
+			timeout = timer_next();
+			tv.tv_sec = (time_t) (timeout / 1000000000);
+			tv.tv_usec = (suseconds_t) (timeout % 1000000000)
+			           / 1000;
+			if (select(karuiwm.xfd + 1, &fds, NULL, NULL,
+			           timeout == UINT64_MAX ? NULL : &tv) < 0
+			&& errno != EINTR)
+				FATAL("select() failed: %s", strerror(errno));
+			continue;
+		}
+
 		if (XNextEvent(karuiwm.dpy, &xe) != 0) {
 			FATAL("failed to fetch next X event");
 			break;
 		}
 		//DEBUG("run(): e.type = %d", xe.type);
-		if (handle[xe.type] != NULL)
-			handle[xe.type](&xe);
+
+		/* look ahead for destroyed windows whenever events have been
+		 * queued since, and drop events for them; the recording notes
+		 * how far, for replay_read() */
+		scanned = 0;
+		if (XQLength(karuiwm.dpy) > 0
+		&& XQLength(karuiwm.dpy) >= queued) {
+			tombstone_scan();
+			scanned = (uint32_t) XQLength(karuiwm.dpy);
+		}
+		record_event(&xe, scanned);
+		queued = XQLength(karuiwm.dpy);
+		if (tombstone_filter(&xe))
+			continue;
+		dispatch(&xe);
 	}
 }
 
@@ -839,12 +1210,22 @@ sigchld(int s)
 	while (waitpid(-1, NULL, WNOHANG) > 0);
 }
 
+static void
+sigusr1(int s)
+{
+	(void) s;
+
+	dumpstats = 1;
+}
+
 static void
 term(void)
 {
 	char sid[BUFSIZ];
 	struct action *a;
 
+	watchdog_term();
+	config_term();
 	while (nactions > 0) {
 		a = actions;
 		LIST_REMOVE(&actions, a);
@@ -855,24 +1236,40 @@ term(void)
 	if (karuiwm.restarting)
 		session_save(karuiwm.session, sid, sizeof(sid));
 	session_delete(karuiwm.session);
+	process_term();
 	cursor_delete(karuiwm.cursor);
 	layout_term();
-	config_term();
 
 	XUngrabKey(karuiwm.dpy, AnyKey, AnyModifier, karuiwm.root);
 	XSetInputFocus(karuiwm.dpy, PointerRoot, RevertToPointerRoot,
 	               CurrentTime);
 	XCloseDisplay(karuiwm.dpy);
+	trace_term();
+	record_term();
+
+#ifdef MODE_DEBUG
+	alloc_dump(stderr);
+	(void) alloc_leaks();
+#endif
+	log_term();
 }
 
 int
 main(int argc, char **argv)
 {
 	karuiwm.env.APPNAME = "karuiwm";
+	(void) log_init();
 	parse_args(argc, argv);
 	init();
-	run();
+	if (replayfile != NULL)
+		replay(replayfile);
+	else
+		run();
 	term();
 	check_restart(argv);
+	if (alloccheck && allocfailures > 0) {
+		ERROR("%"PRIu64" events allocated memory", allocfailures);
+		return EXIT_FAILURE;
+	}
 	return EXIT_SUCCESS;
 }
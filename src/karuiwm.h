@@ -31,6 +31,7 @@ enum netatom_type {
 	_NET_ACTIVE_WINDOW,
 	_NET_SUPPORTED,
 	_NET_WM_NAME,
+	_NET_WM_PID,
 	_NET_WM_STATE,
 	_NET_WM_STATE_FULLSCREEN,
 	_NET_WM_STATE_HIDDEN,
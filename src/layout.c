@@ -1,7 +1,6 @@
 #include "layout.h"
 #include "util.h"
 #include "list.h"
-#include <string.h>
 
 #include "layouts/rstack.h"
 #include "layouts/monocle.h"
@@ -12,7 +11,8 @@ static struct layout *layout_new(layout_func apply, char const *name);
 static void
 layout_delete(struct layout *l)
 {
-	free(l);
+	sfree(l->name);
+	sfree(l);
 }
 
 void
@@ -36,8 +36,7 @@ layout_new(layout_func apply, char const *name)
 
 	l = smalloc(sizeof(struct layout), "layout");
 	l->apply = apply;
-	strncpy(l->name, name, LAYOUT_NAMELEN);
-	l->name[LAYOUT_NAMELEN - 1] = '\0';
+	l->name = strdupf("%s", name);
 	return l;
 }
 
@@ -4,15 +4,13 @@
 #include "client.h"
 #include <stdlib.h>
 
-#define LAYOUT_NAMELEN 512
-
 typedef void (*layout_func)(struct client *, size_t, size_t, float,
                             int, int, int unsigned, int unsigned);
 
 struct layout {
 	struct layout *prev, *next;
 	layout_func apply;
-	char name[LAYOUT_NAMELEN];
+	char *name;
 };
 
 void layout_init(void);
@@ -14,6 +14,18 @@ list_append(struct list_element **head, struct list_element *e)
 	}
 }
 
+void
+list_insert(struct list_element **head, struct list_element *e,
+            struct list_element *next)
+{
+	/* insert e before next, which must be in the list */
+	e->prev = next->prev;
+	e->next = next;
+	e->prev->next = e->next->prev = e;
+	if (next == *head)
+		*head = e;
+}
+
 inline struct list_element *
 list_neighbour(struct list_element *e, int dir)
 {
@@ -5,6 +5,9 @@
 
 #define LIST_APPEND(H, E) list_append((struct list_element **) (H), \
                                       (struct list_element *) (E))
+#define LIST_INSERT(H, E, N) list_insert((struct list_element **) (H), \
+                                      (struct list_element *) (E), \
+                                      (struct list_element *) (N))
 #define LIST_PREPEND(H, E) list_prepend((struct list_element **) (H), \
                                         (struct list_element *) (E))
 #define LIST_REMOVE(H, E) list_remove((struct list_element **) (H), \
@@ -19,6 +22,8 @@ struct list_element {
 };
 
 void list_append(struct list_element **head, struct list_element *e);
+void list_insert(struct list_element **head, struct list_element *e,
+                 struct list_element *next);
 struct list_element *list_neighbour(struct list_element *e, int dir);
 void list_prepend(struct list_element **head, struct list_element *e);
 void list_remove(struct list_element **head, struct list_element *e);
@@ -0,0 +1,286 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "log.h"
+#include "karuiwm.h"
+#include "timer.h"
+#include "util.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#define ESC "\033"
+#define ESC_BOLD    ESC"[1m"
+#define ESC_BLACK   ESC"[30m"
+#define ESC_RED     ESC"[31m"
+#define ESC_GREEN   ESC"[32m"
+#define ESC_YELLOW  ESC"[33m"
+#define ESC_BLUE    ESC"[34m"
+#define ESC_MAGENTA ESC"[35m"
+#define ESC_CYAN    ESC"[36m"
+#define ESC_WHITE   ESC"[37m"
+#define ESC_RESET   ESC"[0m"
+
+struct log_message {
+	uint64_t seq; /* see submit() */
+	FILE *f;
+	enum log_level level;
+	char const *filename;
+	int unsigned line;
+	time_t time;
+	char text[LOG_LINELEN];
+};
+
+static void atfork_child(void);
+static void *drain(void *arg);
+static void summarise(void *arg);
+static void submit(FILE *f, enum log_level level, char const *filename,
+                   int unsigned line, char const *format, va_list args);
+static void write_message(struct log_message *m);
+
+/* bounded multi-producer (event loop, watchdog), single-consumer queue: a
+ * slot is free for position p if seq == p, and holds a message if
+ * seq == p + 1; producers claim positions with a CAS on tail */
+static struct {
+	bool running;
+	enum log_level level;
+	pthread_t thread;
+	sem_t sem;
+	uint64_t head, tail;
+	uint64_t dropped, reported;
+	struct log_message ring[LOG_RINGSIZE];
+	struct log_site *sites;
+	struct timer period;
+} logger = { .period = TIMER_INIT(summarise, NULL) };
+
+static void
+atfork_child(void)
+{
+	/* the drain thread does not exist in the child, the parent writes out
+	 * the queued messages */
+	logger.running = false;
+}
+
+static void *
+drain(void *arg)
+{
+	struct log_message *m;
+	uint64_t dropped;
+	bool running = true;
+	(void) arg;
+
+	while (running) {
+		(void) sem_wait(&logger.sem);
+		running = __atomic_load_n(&logger.running, __ATOMIC_ACQUIRE);
+		for (;;) {
+			m = &logger.ring[logger.head % LOG_RINGSIZE];
+			if (__atomic_load_n(&m->seq, __ATOMIC_ACQUIRE)
+			    != logger.head + 1)
+				break;
+			write_message(m);
+			__atomic_store_n(&m->seq, logger.head + LOG_RINGSIZE,
+			                 __ATOMIC_RELEASE);
+			++logger.head;
+		}
+		dropped = __atomic_load_n(&logger.dropped, __ATOMIC_RELAXED);
+		if (dropped != logger.reported) {
+			(void) fprintf(stderr, "%s: %"PRIu64" log messages "
+			               "dropped\n", karuiwm.env.APPNAME,
+			               dropped - logger.reported);
+			logger.reported = dropped;
+		}
+		(void) fflush(stdout);
+		(void) fflush(stderr);
+	}
+	return NULL;
+}
+
+void
+log_dump(FILE *f)
+{
+	struct log_site *s;
+
+	for (s = logger.sites; s != NULL; s = s->next)
+		(void) fprintf(f, "warn %s:%u count=%"PRIu64"\n",
+		               s->filename, s->line, s->count);
+}
+
+int
+log_init(void)
+{
+	int err;
+	uint64_t i;
+
+	for (i = 0; i < LOG_RINGSIZE; ++i)
+		logger.ring[i].seq = i;
+	logger.head = logger.tail = logger.dropped = logger.reported = 0;
+	if (sem_init(&logger.sem, 0, 0) < 0) {
+		ERROR("could not initialise log semaphore: %s",
+		      strerror(errno));
+		return -1;
+	}
+	logger.running = true;
+	err = pthread_create(&logger.thread, NULL, drain, NULL);
+	if (err != 0) {
+		logger.running = false;
+		(void) sem_destroy(&logger.sem);
+		ERROR("could not start log thread: %s", strerror(err));
+		return -1;
+	}
+	(void) pthread_atfork(NULL, NULL, atfork_child);
+	return 0;
+}
+
+bool
+log_limit(struct log_site *site)
+{
+	if (!site->registered) {
+		site->next = logger.sites;
+		logger.sites = site;
+		site->registered = true;
+	}
+	++site->count;
+	if (site->period++ == 0) {
+		if (!logger.period.armed)
+			timer_arm(&logger.period,
+			          (uint64_t) LOG_PERIOD * 1000000000);
+		return true;
+	}
+	return false;
+}
+
+void
+log_term(void)
+{
+	if (!__atomic_exchange_n(&logger.running, false, __ATOMIC_ACQ_REL))
+		return;
+
+	/* the drain thread empties the queue before it exits */
+	(void) sem_post(&logger.sem);
+	(void) pthread_join(logger.thread, NULL);
+	(void) sem_destroy(&logger.sem);
+}
+
+void
+print(FILE *f, enum log_level level, char const *filename, int unsigned line,
+      char const *format, ...)
+{
+	va_list args;
+	struct log_message m;
+
+	if (level > logger.level)
+		return;
+
+	va_start(args, format);
+	if (__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)
+	&& level != LOG_FATAL) {
+		submit(f, level, filename, line, format, args);
+		va_end(args);
+		return;
+	}
+
+	/* no drain thread, or about to exit: write everything out now */
+	log_term();
+	m.f = f;
+	m.level = level;
+	m.filename = filename;
+	m.line = line;
+	m.time = time(NULL);
+	(void) vsnprintf(m.text, LOG_LINELEN, format, args);
+	va_end(args);
+	write_message(&m);
+	(void) fflush(f);
+}
+
+void
+set_log_level(enum log_level level)
+{
+	logger.level = level;
+}
+
+static void
+summarise(void *arg)
+{
+	struct log_site *s;
+	(void) arg;
+
+	for (s = logger.sites; s != NULL; s = s->next) {
+		if (s->period > 1)
+			print(stderr, LOG_WARN, s->filename, s->line,
+			      "%"PRIu64" more warnings from %s:%u in the "
+			      "last %ds", s->period - 1, s->filename, s->line,
+			      LOG_PERIOD);
+		s->period = 0;
+	}
+}
+
+static void
+submit(FILE *f, enum log_level level, char const *filename,
+       int unsigned line, char const *format, va_list args)
+{
+	struct log_message *m;
+	uint64_t pos, seq;
+
+	pos = __atomic_load_n(&logger.tail, __ATOMIC_RELAXED);
+	for (;;) {
+		m = &logger.ring[pos % LOG_RINGSIZE];
+		seq = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&logger.tail, &pos,
+			                                pos + 1, true,
+			                                __ATOMIC_RELAXED,
+			                                __ATOMIC_RELAXED))
+				break;
+		} else if (seq < pos) {
+			/* full: never wait for a slow terminal */
+			__atomic_add_fetch(&logger.dropped, 1, __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&logger.tail, __ATOMIC_RELAXED);
+		}
+	}
+	m->f = f;
+	m->level = level;
+	m->filename = filename;
+	m->line = line;
+	m->time = time(NULL);
+	(void) vsnprintf(m->text, LOG_LINELEN, format, args);
+	__atomic_store_n(&m->seq, pos + 1, __ATOMIC_RELEASE);
+	(void) sem_post(&logger.sem);
+}
+
+static void
+write_message(struct log_message *m)
+{
+	struct tm date;
+	char const *col;
+
+	/* application name & timestamp */
+	(void) localtime_r(&m->time, &date);
+	(void) fprintf(m->f, "%s %04d-%02d-%02dT%02d:%02d:%02d ",
+	               karuiwm.env.APPNAME,
+	               date.tm_year+1900, date.tm_mon + 1, date.tm_mday,
+	               date.tm_hour, date.tm_min, date.tm_sec);
+
+	/* log level */
+	switch (m->level) {
+	case LOG_FATAL : col = ESC_BOLD ESC_RED    "FATAL" ESC_RESET " "; break;
+	case LOG_ERROR : col =          ESC_RED    "ERROR" ESC_RESET " "; break;
+	case LOG_WARN  : col =          ESC_YELLOW "WARN"  ESC_RESET " "; break;
+	case LOG_NOTICE: col =          ESC_CYAN   "NOTICE"ESC_RESET " "; break;
+	case LOG_EVENT : col =          ESC_MAGENTA"EVENT" ESC_RESET " "; break;
+	case LOG_DEBUG : col =          ESC_BLUE   "DEBUG" ESC_RESET " "; break;
+	default        : col =                                        "";
+	}
+	(void) fprintf(m->f, "%s%s", col, m->text);
+
+	/* position */
+	if (m->level >= LOG_EVENT)
+		(void) fprintf(m->f, " \033[32m%s:%u\033[0m", m->filename,
+		               m->line);
+
+	(void) fprintf(m->f, "\n");
+}
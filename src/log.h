@@ -0,0 +1,10 @@
+#ifndef _KARUIWM_LOG_H
+#define _KARUIWM_LOG_H
+
+#define LOG_RINGSIZE 256 /* messages */
+#define LOG_LINELEN 512 /* bytes per formatted message */
+
+int log_init(void);
+void log_term(void);
+
+#endif /* ndef _KARUIWM_LOG_H */
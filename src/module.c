@@ -109,6 +109,7 @@ module_new(char const *name)
 
 	mod = smalloc(sizeof(struct module), "module");
 	mod->name = strdupf(name);
+	mod->so_path = NULL;
 	mod->so_handler = so_handler;
 	mod->init = init;
 
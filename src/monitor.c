@@ -2,6 +2,9 @@
 #include "desktop.h"
 #include "util.h"
 #include "monitor.h"
+#include "probe.h"
+
+static struct slab monitor_slab = SLAB_INIT("monitor", struct monitor);
 
 int unsigned
 monitor_client_intersect(struct monitor *m, struct client *c)
@@ -20,7 +23,8 @@ void
 monitor_delete(struct monitor *m)
 {
 	desktop_show(m->seldt, NULL);
-	free(m);
+	XDestroyWindow(karuiwm.dpy, m->input);
+	slab_free(&monitor_slab, m);
 }
 
 void
@@ -34,14 +38,26 @@ monitor_new(struct focus *f, struct desktop *d, int x, int y,
             int unsigned w, int unsigned h)
 {
 	struct monitor *m;
+	XSetWindowAttributes wa;
 
-	m = smalloc(sizeof(struct monitor), "monitor");
+	m = slab_alloc(&monitor_slab);
 	m->x = x;
 	m->y = y;
 	m->w = w;
 	m->h = h;
 	m->seldt = d;
 	m->focus = f;
+
+	/* the pointer entering the uncovered part of the monitor, instead of
+	 * following every motion on the root window */
+	wa.override_redirect = True;
+	wa.event_mask = EnterWindowMask;
+	m->input = XCreateWindow(karuiwm.dpy, karuiwm.root, x, y, w, h, 0,
+	                         CopyFromParent, InputOnly, CopyFromParent,
+	                         CWOverrideRedirect | CWEventMask, &wa);
+	XLowerWindow(karuiwm.dpy, m->input);
+	XMapWindow(karuiwm.dpy, m->input);
+
 	desktop_show(d, m);
 	return m;
 }
@@ -57,17 +73,14 @@ monitor_show_desktop(struct monitor *m, struct desktop *d)
 	othermon = d->monitor;
 	if (new == old)
 		return;
+	PROBE3(monitor_show_desktop, m->index, new->posx, new->posy);
 
-	/* show new desktop */
-	desktop_show(new, m);
+	/* show new desktop and hide (or swap) old one in one batch */
+	desktop_switch(new, m, old, othermon);
 	desktop_set_focus(new, m == m->focus->selmon);
-
-	/* hide old desktop */
 	if (old->nt + old->nf == 0) {
 		workspace_detach_desktop(old->workspace, old);
 		desktop_delete(old);
-	} else {
-		desktop_show(old, othermon);
 	}
 
 	m->seldt = new;
@@ -92,10 +105,7 @@ monitor_step_desktop(struct monitor *m, enum direction dir)
 	dst = workspace_locate_desktop(ws, posx, posy);
 	if (dst == NULL) {
 		dst = desktop_new();
-		workspace_attach_desktop(ws, dst);
-		/* FIXME desktop positioning hack */
-		dst->posx = posx;
-		dst->posy = posy;
+		workspace_attach_desktop_at(ws, dst, posx, posy);
 	}
 	monitor_show_desktop(m, dst);
 }
@@ -108,5 +118,6 @@ monitor_update_geometry(struct monitor *m,
 	m->y = y;
 	m->w = w;
 	m->h = h;
+	XMoveResizeWindow(karuiwm.dpy, m->input, x, y, w, h);
 	desktop_arrange(m->seldt);
 }
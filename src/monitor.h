@@ -12,6 +12,7 @@ struct monitor {
 	struct desktop *seldt;
 	struct focus *focus;
 	int unsigned index;
+	Window input; /* InputOnly, below all clients, reports EnterNotify */
 };
 
 int unsigned monitor_client_intersect(struct monitor *m, struct client *c);
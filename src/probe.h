@@ -0,0 +1,18 @@
+#ifndef _KARUIWM_PROBE_H
+#define _KARUIWM_PROBE_H
+
+/* USDT static probes (provider "karuiwm"), see tools/probes */
+#ifdef USDT
+# include <sys/sdt.h>
+# define PROBE(N)             DTRACE_PROBE(karuiwm, N)
+# define PROBE1(N, A)         DTRACE_PROBE1(karuiwm, N, A)
+# define PROBE2(N, A, B)      DTRACE_PROBE2(karuiwm, N, A, B)
+# define PROBE3(N, A, B, C)   DTRACE_PROBE3(karuiwm, N, A, B, C)
+#else
+# define PROBE(N)
+# define PROBE1(N, A)
+# define PROBE2(N, A, B)
+# define PROBE3(N, A, B, C)
+#endif
+
+#endif /* ndef _KARUIWM_PROBE_H */
@@ -0,0 +1,397 @@
+#define _XOPEN_SOURCE 500
+
+#include "process.h"
+#include "karuiwm.h"
+#include "config.h"
+#include "util.h"
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static void cont(struct process *p);
+static void cont_all(void);
+static void demote(struct process *p);
+static void fatal_signal(int sig);
+static void forget(struct process *p);
+static struct process **locate(pid_t pid);
+static int read_oom(pid_t pid, int *oom);
+static int renice(pid_t pid, int nice);
+static void restore(struct process *p);
+static void stop(void *arg);
+static void update_priorities(void *arg);
+static int write_oom(pid_t pid, int oom);
+
+/* signals that terminate karuiwm without term() */
+static int const fatal_signals[] = {
+	SIGABRT, SIGBUS, SIGFPE, SIGHUP, SIGILL, SIGINT, SIGSEGV, SIGTERM,
+};
+
+static struct slab process_slab = SLAB_INIT("process", struct process);
+
+static struct {
+	struct process *buckets[PROCESS_BUCKETS];
+	uint64_t stops, conts, demotions, restores;
+	size_t nstopped, ndemoted;
+	struct timer batch;
+	int min_nice; /* lowest niceness we may restore */
+	pid_t owner; /* not in children that exit before exec */
+} processes = { .batch = TIMER_INIT(update_priorities, NULL), .min_nice = 20 };
+
+static void
+cont(struct process *p)
+{
+	if (!p->stopped)
+		return;
+	p->stopped = false;
+	--processes.nstopped;
+	if (kill(p->pid, SIGCONT) < 0) {
+		WARN_LIMIT("could not continue process %ld: %s",
+		           (long) p->pid, strerror(errno));
+		return;
+	}
+	++processes.conts;
+}
+
+static void
+cont_all(void)
+{
+	size_t i;
+	struct process *p;
+
+	/* also called from signal handlers: kill() only, no logging */
+	if (getpid() != processes.owner)
+		return;
+	for (i = 0; i < PROCESS_BUCKETS; ++i)
+		for (p = processes.buckets[i]; p != NULL; p = p->next)
+			if (p->stopped)
+				(void) kill(p->pid, SIGCONT);
+}
+
+static void
+demote(struct process *p)
+{
+	if (p->demoted)
+		return;
+
+	/* read the original values only once, so that a failed restore does
+	 * not make the lowered priority the new baseline */
+	if (!p->saved) {
+		errno = 0;
+		p->nice = getpriority(PRIO_PROCESS, (id_t) p->pid);
+		if (errno != 0 || read_oom(p->pid, &p->oom) < 0) {
+			WARN_LIMIT("could not read priority of process %ld: %s",
+			           (long) p->pid, strerror(errno));
+			return;
+		}
+		p->saved = true;
+	}
+
+	/* restore() undoes whatever part of this succeeded */
+	p->demoted = true;
+	++processes.ndemoted;
+	++processes.demotions;
+	if ((p->nice >= processes.min_nice
+	     && renice(p->pid, MIN(p->nice + config.priority.nice, 19)) < 0)
+	|| write_oom(p->pid, MIN(p->oom + config.priority.oom, 1000)) < 0)
+		WARN_LIMIT("could not lower priority of process %ld: %s",
+		           (long) p->pid, strerror(errno));
+}
+
+static void
+fatal_signal(int sig)
+{
+	/* SA_RESETHAND restored the default action, SA_NODEFER lets it act */
+	cont_all();
+	(void) raise(sig);
+}
+
+static void
+forget(struct process *p)
+{
+	timer_cancel(&p->stop);
+	cont(p);
+	restore(p);
+	if (p->demoted)
+		--processes.ndemoted;
+}
+
+static struct process **
+locate(pid_t pid)
+{
+	struct process **p;
+
+	p = &processes.buckets[(size_t) pid % PROCESS_BUCKETS];
+	while (*p != NULL && (*p)->pid != pid)
+		p = &(*p)->next;
+	return p;
+}
+
+struct process *
+process_attach(pid_t pid, bool exempt)
+{
+	struct process **pp, *p;
+
+	/* never stop ourselves or init */
+	if (pid <= 1 || pid == getpid())
+		return NULL;
+	pp = locate(pid);
+	p = *pp;
+	if (p == NULL) {
+		p = slab_alloc(&process_slab);
+		p->next = NULL;
+		p->pid = pid;
+		p->nwins = p->nvisible = p->nexempt = 0;
+		p->stopped = false;
+		p->stop = (struct timer) TIMER_INIT(stop, p);
+		p->demoted = p->saved = false;
+		*pp = p;
+	}
+	++p->nwins;
+	if (exempt)
+		++p->nexempt;
+	return p;
+}
+
+void
+process_detach(struct process *p, bool visible, bool exempt)
+{
+	struct process **pp;
+
+	--p->nwins;
+	if (visible)
+		--p->nvisible;
+	if (exempt)
+		--p->nexempt;
+	if (p->nwins > 0)
+		return;
+
+	/* a process without windows is none of our business */
+	forget(p);
+	pp = locate(p->pid);
+	*pp = p->next;
+	slab_free(&process_slab, p);
+}
+
+void
+process_dump(FILE *f)
+{
+	(void) fprintf(f, "process stopped=%zu stops=%"PRIu64
+	               " conts=%"PRIu64" demoted=%zu demotions=%"PRIu64
+	               " restores=%"PRIu64"\n",
+	               processes.nstopped, processes.stops, processes.conts,
+	               processes.ndemoted, processes.demotions,
+	               processes.restores);
+}
+
+void
+process_hide(struct process *p, bool freeze)
+{
+	--p->nvisible;
+	if (p->nvisible > 0)
+		return;
+	if (config.priority.enable && !processes.batch.armed)
+		timer_arm(&processes.batch, PROCESS_BATCH * 1000000);
+	if (!config.freeze.enable || !freeze || p->nexempt > 0 || p->stopped)
+		return;
+	timer_arm(&p->stop, (uint64_t) config.freeze.delay * 1000000);
+}
+
+void
+process_init(void)
+{
+	char line[256];
+	long long unsigned caps = 0;
+	size_t i;
+	struct rlimit rl;
+	struct sigaction sa;
+	FILE *f;
+
+	/* stopped processes are continued however karuiwm exits: exit() (e.g.
+	 * FATAL, or a lost X connection) and fatal signals */
+	processes.owner = getpid();
+	if (atexit(cont_all) != 0)
+		WARN("could not register exit handler");
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = fatal_signal;
+	sa.sa_flags = (int) (SA_RESETHAND | SA_NODEFER);
+	(void) sigemptyset(&sa.sa_mask);
+	for (i = 0; i < sizeof(fatal_signals) / sizeof(fatal_signals[0]); ++i)
+		if (sigaction(fatal_signals[i], &sa, NULL) < 0)
+			WARN("could not install handler for signal %d",
+			     fatal_signals[i]);
+
+	/* without CAP_SYS_NICE, RLIMIT_NICE bounds how far the niceness can be
+	 * lowered again; niceness below that bound is left alone */
+	f = fopen("/proc/self/status", "r");
+	if (f != NULL) {
+		while (fgets(line, sizeof(line), f) != NULL)
+			if (sscanf(line, "CapEff: %llx", &caps) == 1)
+				break;
+		(void) fclose(f);
+	}
+	if (caps & (1ULL << PROCESS_CAP_SYS_NICE))
+		processes.min_nice = -20;
+	else if (getrlimit(RLIMIT_NICE, &rl) == 0)
+		processes.min_nice = rl.rlim_cur == RLIM_INFINITY ? -20
+		                   : 20 - (int) MIN(rl.rlim_cur, 40);
+	if (config.priority.enable && processes.min_nice > 0)
+		WARN("niceness cannot be restored without CAP_SYS_NICE or "
+		     "an RLIMIT_NICE of 20, only oom_score_adj is changed");
+}
+
+bool
+process_is_local(char const *machine)
+{
+	char host[256];
+
+	if (gethostname(host, sizeof(host)) < 0)
+		return false;
+	host[sizeof(host) - 1] = '\0';
+	return strcmp(host, machine) == 0;
+}
+
+void
+process_show(struct process *p)
+{
+	/* continue before the window is mapped again */
+	++p->nvisible;
+	timer_cancel(&p->stop);
+	cont(p);
+	if (p->nvisible == 1 && p->demoted && !processes.batch.armed)
+		timer_arm(&processes.batch, PROCESS_BATCH * 1000000);
+}
+
+void
+process_term(void)
+{
+	size_t i;
+	struct process *p;
+
+	timer_cancel(&processes.batch);
+	for (i = 0; i < PROCESS_BUCKETS; ++i) {
+		while ((p = processes.buckets[i]) != NULL) {
+			forget(p);
+			processes.buckets[i] = p->next;
+			slab_free(&process_slab, p);
+		}
+	}
+}
+
+static int
+read_oom(pid_t pid, int *oom)
+{
+	char path[64];
+	int ret;
+	FILE *f;
+
+	(void) snprintf(path, sizeof(path), "/proc/%ld/oom_score_adj",
+	                (long) pid);
+	f = fopen(path, "r");
+	if (f == NULL)
+		return -1;
+	ret = fscanf(f, "%d", oom) == 1 ? 0 : -1;
+	(void) fclose(f);
+	return ret;
+}
+
+static int
+renice(pid_t pid, int nice)
+{
+	char path[64];
+	int ret = 0;
+	long tid;
+	DIR *dir;
+	struct dirent *de;
+
+	/* on Linux, PRIO_PROCESS applies to a single thread, so set all of
+	 * them; threads that exit meanwhile are no error */
+	(void) snprintf(path, sizeof(path), "/proc/%ld/task", (long) pid);
+	dir = opendir(path);
+	if (dir == NULL)
+		return setpriority(PRIO_PROCESS, (id_t) pid, nice);
+	while ((de = readdir(dir)) != NULL) {
+		tid = strtol(de->d_name, NULL, 10);
+		if (tid > 0 && setpriority(PRIO_PROCESS, (id_t) tid, nice) < 0
+		&& errno != ESRCH)
+			ret = -1;
+	}
+	(void) closedir(dir);
+	return ret;
+}
+
+static void
+restore(struct process *p)
+{
+	if (!p->demoted)
+		return;
+
+	/* stays demoted on failure, so it is not demoted twice */
+	if ((p->nice >= processes.min_nice && renice(p->pid, p->nice) < 0)
+	|| write_oom(p->pid, p->oom) < 0) {
+		WARN_LIMIT("could not restore priority of process %ld: %s",
+		           (long) p->pid, strerror(errno));
+		return;
+	}
+	p->demoted = false;
+	--processes.ndemoted;
+	++processes.restores;
+}
+
+static void
+stop(void *arg)
+{
+	struct process *p = arg;
+
+	if (p->nvisible > 0 || p->nexempt > 0 || p->stopped)
+		return;
+	if (kill(p->pid, SIGSTOP) < 0) {
+		WARN_LIMIT("could not stop process %ld: %s",
+		           (long) p->pid, strerror(errno));
+		return;
+	}
+	p->stopped = true;
+	++processes.nstopped;
+	++processes.stops;
+}
+
+static void
+update_priorities(void *arg)
+{
+	size_t i;
+	struct process *p;
+	(void) arg;
+
+	/* demote processes with only hidden windows, restore the others */
+	for (i = 0; i < PROCESS_BUCKETS; ++i) {
+		for (p = processes.buckets[i]; p != NULL; p = p->next) {
+			if (p->nvisible == 0 && p->nexempt == 0)
+				demote(p);
+			else
+				restore(p);
+		}
+	}
+}
+
+static int
+write_oom(pid_t pid, int oom)
+{
+	char path[64];
+	int ret;
+	FILE *f;
+
+	(void) snprintf(path, sizeof(path), "/proc/%ld/oom_score_adj",
+	                (long) pid);
+	f = fopen(path, "w");
+	if (f == NULL)
+		return -1;
+	ret = fprintf(f, "%d", oom) < 0 ? -1 : 0;
+	if (fclose(f) != 0)
+		ret = -1;
+	return ret;
+}
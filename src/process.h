@@ -0,0 +1,34 @@
+#ifndef _KARUIWM_PROCESS_H
+#define _KARUIWM_PROCESS_H
+
+#include "timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define PROCESS_BUCKETS 256 /* hash table size */
+#define PROCESS_BATCH 100 /* ms between priority updates */
+#define PROCESS_CAP_SYS_NICE 23 /* bit in CapEff, see capabilities(7) */
+
+/* a local process owning client windows, from _NET_WM_PID */
+struct process {
+	struct process *next; /* hash chain */
+	pid_t pid;
+	size_t nwins, nvisible, nexempt;
+	bool stopped;
+	struct timer stop;
+	bool demoted; /* niceness and oom_score_adj raised */
+	bool saved; /* nice and oom are read */
+	int nice, oom; /* before the first demotion */
+};
+
+struct process *process_attach(pid_t pid, bool exempt);
+void process_detach(struct process *p, bool visible, bool exempt);
+void process_dump(FILE *f);
+void process_hide(struct process *p, bool freeze);
+void process_init(void);
+bool process_is_local(char const *machine);
+void process_show(struct process *p);
+void process_term(void);
+
+#endif /* ndef _KARUIWM_PROCESS_H */
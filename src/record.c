@@ -0,0 +1,138 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "record.h"
+#include "karuiwm.h"
+#include "stats.h"
+#include "util.h"
+#include <errno.h>
+#include <string.h>
+
+/* Each record is the time since the start of the recording (nanoseconds), the
+ * event type (one byte), the number of following events that were scanned for
+ * destroyed windows after it (see tombstone_scan(), 0 if there was no scan) and
+ * the event-specific part of the XEvent union. Key events carry the keysym in
+ * place of the keycode, so a replay does not depend on the keyboard mapping of
+ * the recording X server. Recordings are in host byte order.
+ */
+
+static size_t event_size(int type);
+
+static struct {
+	FILE *f;
+	uint64_t start;
+} record;
+
+void
+record_event(XEvent *xe, uint32_t lookahead)
+{
+	XEvent ev;
+	uint64_t t;
+	char unsigned type = (char unsigned) xe->type;
+	size_t size = event_size(xe->type);
+
+	if (record.f == NULL)
+		return;
+	ev = *xe;
+	if (ev.type == KeyPress || ev.type == KeyRelease)
+		ev.xkey.keycode = (int unsigned) XLookupKeysym(&xe->xkey, 0);
+	t = stats_now() - record.start;
+	if (fwrite(&t, sizeof(t), 1, record.f) != 1
+	|| fwrite(&type, sizeof(type), 1, record.f) != 1
+	|| fwrite(&lookahead, sizeof(lookahead), 1, record.f) != 1
+	|| fwrite(&ev, size, 1, record.f) != 1) {
+		ERROR("could not write event to recording, stopping");
+		record_term();
+	}
+}
+
+int
+record_init(char const *path)
+{
+	record.f = fopen(path, "w");
+	if (record.f == NULL) {
+		ERROR("could not open recording file %s: %s",
+		      path, strerror(errno));
+		return -1;
+	}
+	record.start = stats_now();
+	(void) fwrite(RECORD_MAGIC, sizeof(RECORD_MAGIC), 1, record.f);
+	return 0;
+}
+
+FILE *
+record_open(char const *path)
+{
+	char magic[sizeof(RECORD_MAGIC)];
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		ERROR("could not open recording file %s: %s",
+		      path, strerror(errno));
+		return NULL;
+	}
+	if (fread(magic, sizeof(magic), 1, f) != 1
+	|| memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0) {
+		ERROR("%s is not a karuiwm recording", path);
+		(void) fclose(f);
+		return NULL;
+	}
+	return f;
+}
+
+int
+record_read(FILE *f, XEvent *xe, uint64_t *t, uint32_t *lookahead)
+{
+	char unsigned type;
+	size_t size;
+
+	if (fread(t, sizeof(*t), 1, f) != 1)
+		return feof(f) ? 0 : -1;
+	if (fread(&type, sizeof(type), 1, f) != 1
+	|| fread(lookahead, sizeof(*lookahead), 1, f) != 1)
+		return -1;
+	size = event_size(type);
+	memset(xe, 0, sizeof(*xe));
+	if (fread(xe, size, 1, f) != 1 || xe->type != type)
+		return -1;
+	xe->xany.display = karuiwm.dpy;
+	return 1;
+}
+
+void
+record_term(void)
+{
+	if (record.f == NULL)
+		return;
+	(void) fclose(record.f);
+	record.f = NULL;
+}
+
+static size_t
+event_size(int type)
+{
+	switch (type) {
+	case KeyPress:
+	case KeyRelease:       return sizeof(XKeyEvent);
+	case ButtonPress:
+	case ButtonRelease:    return sizeof(XButtonEvent);
+	case MotionNotify:     return sizeof(XMotionEvent);
+	case EnterNotify:
+	case LeaveNotify:      return sizeof(XCrossingEvent);
+	case FocusIn:
+	case FocusOut:         return sizeof(XFocusChangeEvent);
+	case Expose:           return sizeof(XExposeEvent);
+	case CreateNotify:     return sizeof(XCreateWindowEvent);
+	case DestroyNotify:    return sizeof(XDestroyWindowEvent);
+	case UnmapNotify:      return sizeof(XUnmapEvent);
+	case MapNotify:        return sizeof(XMapEvent);
+	case MapRequest:       return sizeof(XMapRequestEvent);
+	case ReparentNotify:   return sizeof(XReparentEvent);
+	case ConfigureNotify:  return sizeof(XConfigureEvent);
+	case ConfigureRequest: return sizeof(XConfigureRequestEvent);
+	case PropertyNotify:   return sizeof(XPropertyEvent);
+	case ClientMessage:    return sizeof(XClientMessageEvent);
+	case MappingNotify:    return sizeof(XMappingEvent);
+	default:               return sizeof(XEvent);
+	}
+}
@@ -0,0 +1,16 @@
+#ifndef _KARUIWM_RECORD_H
+#define _KARUIWM_RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <X11/Xlib.h>
+
+#define RECORD_MAGIC "karuiwm-record-3"
+
+void record_event(XEvent *xe, uint32_t lookahead);
+int record_init(char const *path);
+FILE *record_open(char const *path);
+int record_read(FILE *f, XEvent *xe, uint64_t *t, uint32_t *lookahead);
+void record_term(void);
+
+#endif /* ndef _KARUIWM_RECORD_H */
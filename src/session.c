@@ -1,6 +1,8 @@
 #include "session.h"
 #include "util.h"
 #include "list.h"
+#include "stats.h"
+#include "trace.h"
 #include <X11/Xlib.h>
 
 static int scan_windows(struct session *s);
@@ -13,7 +15,8 @@ scan_windows(struct session *s)
 	int unsigned i, nwins;
 	struct client *c;
 
-	if (!XQueryTree(karuiwm.dpy, karuiwm.root, &win, &win, &wins, &nwins)) {
+	if (!ROUNDTRIP(XQueryTree(karuiwm.dpy, karuiwm.root, &win, &win,
+	                          &wins, &nwins))) {
 		WARN("XQueryTree() failed");
 		return -1;
 	}
@@ -65,9 +68,12 @@ session_locate_window(struct session *s, struct client **c, Window w)
 	int unsigned i;
 	struct workspace *ws;
 
-	for (i = 0, ws = s->workspaces; i < s->nws; ++i, ws = ws->next)
-		if (workspace_locate_window(ws, c, w) == 0)
+	for (i = 0, ws = s->workspaces; i < s->nws; ++i, ws = ws->next) {
+		if (workspace_locate_window(ws, c, w) == 0) {
+			trace_name_window(w, (*c)->cold->name);
 			return 0;
+		}
+	}
 	return -1;
 }
 
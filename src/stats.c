@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "stats.h"
+#include "karuiwm.h"
+#include "action.h"
+#include "util.h"
+#include "process.h"
+#include "steal.h"
+#include "tombstone.h"
+#include "xerror.h"
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+static int unsigned bucket_index(uint64_t ns);
+static uint64_t bucket_limit(int unsigned i);
+static uint64_t percentile(struct stats_entry *e, double p);
+
+static char const *event_names[LASTEvent] = {
+	[KeyPress]         = "KeyPress",
+	[KeyRelease]       = "KeyRelease",
+	[ButtonPress]      = "ButtonPress",
+	[ButtonRelease]    = "ButtonRelease",
+	[MotionNotify]     = "MotionNotify",
+	[EnterNotify]      = "EnterNotify",
+	[LeaveNotify]      = "LeaveNotify",
+	[FocusIn]          = "FocusIn",
+	[FocusOut]         = "FocusOut",
+	[KeymapNotify]     = "KeymapNotify",
+	[Expose]           = "Expose",
+	[GraphicsExpose]   = "GraphicsExpose",
+	[NoExpose]         = "NoExpose",
+	[VisibilityNotify] = "VisibilityNotify",
+	[CreateNotify]     = "CreateNotify",
+	[DestroyNotify]    = "DestroyNotify",
+	[UnmapNotify]      = "UnmapNotify",
+	[MapNotify]        = "MapNotify",
+	[MapRequest]       = "MapRequest",
+	[ReparentNotify]   = "ReparentNotify",
+	[ConfigureNotify]  = "ConfigureNotify",
+	[ConfigureRequest] = "ConfigureRequest",
+	[GravityNotify]    = "GravityNotify",
+	[ResizeRequest]    = "ResizeRequest",
+	[CirculateNotify]  = "CirculateNotify",
+	[CirculateRequest] = "CirculateRequest",
+	[PropertyNotify]   = "PropertyNotify",
+	[SelectionClear]   = "SelectionClear",
+	[SelectionRequest] = "SelectionRequest",
+	[SelectionNotify]  = "SelectionNotify",
+	[ColormapNotify]   = "ColormapNotify",
+	[ClientMessage]    = "ClientMessage",
+	[MappingNotify]    = "MappingNotify",
+	[GenericEvent]     = "GenericEvent",
+};
+
+static int unsigned
+bucket_index(uint64_t ns)
+{
+	int unsigned msb, i;
+
+	if (ns < STATS_SUBBUCKETS)
+		return (int unsigned) ns;
+	msb = 63 - (int unsigned) __builtin_clzll(ns);
+	i = (msb - 1) * STATS_SUBBUCKETS
+	  + (int unsigned) ((ns >> (msb - 2)) & (STATS_SUBBUCKETS - 1));
+	return MIN(i, STATS_BUCKETS - 1);
+}
+
+static uint64_t
+bucket_limit(int unsigned i)
+{
+	int unsigned shift;
+
+	if (i < STATS_SUBBUCKETS)
+		return i;
+	shift = i / STATS_SUBBUCKETS - 1;
+	return ((uint64_t) (STATS_SUBBUCKETS + i % STATS_SUBBUCKETS) << shift)
+	     + ((uint64_t) 1 << shift) - 1;
+}
+
+static uint64_t
+percentile(struct stats_entry *e, double p)
+{
+	int unsigned i;
+	uint64_t n = 0, rank = (uint64_t) (p * (double) e->count);
+
+	for (i = 0; i < STATS_BUCKETS; ++i) {
+		n += e->buckets[i];
+		if (n > rank)
+			return MIN(bucket_limit(i), e->max);
+	}
+	return e->max;
+}
+
+void
+stats_dump(FILE *f)
+{
+	int unsigned i;
+	struct action *a;
+
+	for (i = 0; i < LASTEvent; ++i)
+		stats_dump_entry(f, &stats.events[i]);
+	stats_dump_entry(f, &stats.arrange);
+	stats_dump_entry(f, &stats.stalls);
+	for (i = 0, a = actions; i < nactions; ++i, a = a->next)
+		stats_dump_entry(f, &a->stats);
+	xerror_dump(f);
+	tombstone_dump(f);
+	process_dump(f);
+	steal_dump(f);
+	log_dump(f);
+	alloc_dump(f);
+	slab_dump(f);
+	(void) fflush(f);
+}
+
+void
+stats_dump_entry(FILE *f, struct stats_entry *e)
+{
+	int unsigned i;
+
+	if (e->count == 0)
+		return;
+	(void) fprintf(f, "stats %s %s count=%"PRIu64" total_ns=%"PRIu64
+	               " max_ns=%"PRIu64" p50_ns=%"PRIu64" p90_ns=%"PRIu64
+	               " p99_ns=%"PRIu64" p999_ns=%"PRIu64" requests=%"PRIu64
+	               " roundtrips=%"PRIu64"\n",
+	               e->kind, e->name, e->count, e->total, e->max,
+	               percentile(e, 0.5), percentile(e, 0.9),
+	               percentile(e, 0.99), percentile(e, 0.999),
+	               e->requests, e->roundtrips);
+	for (i = 0; i < STATS_BUCKETS; ++i)
+		if (e->buckets[i] > 0)
+			(void) fprintf(f, "bucket %s %s le_ns=%"PRIu64
+			               " count=%"PRIu64"\n",
+			               e->kind, e->name, bucket_limit(i),
+			               e->buckets[i]);
+}
+
+char const *
+stats_event_name(int type)
+{
+	if (type < 0 || type >= LASTEvent || event_names[type] == NULL)
+		return "unknown";
+	return event_names[type];
+}
+
+void
+stats_init(void)
+{
+	int unsigned i;
+
+	for (i = 0; i < LASTEvent; ++i)
+		stats_init_entry(&stats.events[i], "event",
+		                 stats_event_name((int) i));
+	stats_init_entry(&stats.arrange, "desktop", "arrange");
+	stats_init_entry(&stats.stalls, "watchdog", "stall");
+
+	/* round trip budgets */
+	stats.arrange.budget = 0;
+	stats.events[ConfigureRequest].budget = 0;
+	stats.events[EnterNotify].budget = 0;
+	stats.events[FocusIn].budget = 0;
+}
+
+void
+stats_init_entry(struct stats_entry *e, char const *kind, char const *name)
+{
+	memset(e, 0, sizeof(struct stats_entry));
+	e->kind = kind;
+	e->name = name;
+	e->budget = -1;
+}
+
+uint64_t
+stats_now(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+void
+stats_record(struct stats_entry *e, uint64_t ns)
+{
+	++e->count;
+	e->total += ns;
+	e->max = MAX(e->max, ns);
+	++e->buckets[bucket_index(ns)];
+}
+
+void
+stats_roundtrip(char const *file, int unsigned line)
+{
+#ifdef MODE_DEBUG
+	struct stats_timer *t;
+	uint64_t n;
+#endif
+
+	++stats.roundtrips;
+
+	/* read by the watchdog thread */
+	__atomic_store_n(&stats.roundtrip_file, file, __ATOMIC_RELAXED);
+	__atomic_store_n(&stats.roundtrip_line, line, __ATOMIC_RELAXED);
+
+#ifdef MODE_DEBUG
+	for (t = stats.timer; t != NULL; t = t->parent) {
+		if (t->entry->budget < 0)
+			continue;
+		n = stats.roundtrips - t->roundtrips;
+		if (n > (uint64_t) t->entry->budget)
+			ERROR("%s %s: round trip #%"PRIu64" at %s:%u exceeds "
+			      "budget of %d", t->entry->kind, t->entry->name, n,
+			      file, line, t->entry->budget);
+	}
+#endif
+}
+
+void
+stats_start(struct stats_timer *t, struct stats_entry *e)
+{
+	t->entry = e;
+	t->parent = stats.timer;
+	t->roundtrips = stats.roundtrips;
+	t->serial = NextRequest(karuiwm.dpy);
+	t->start = stats_now();
+	stats.timer = t;
+}
+
+void
+stats_stop(struct stats_timer *t)
+{
+	struct stats_entry *e = t->entry;
+
+	stats_record(e, stats_now() - t->start);
+	e->requests += NextRequest(karuiwm.dpy) - t->serial;
+	e->roundtrips += stats.roundtrips - t->roundtrips;
+	stats.timer = t->parent;
+}
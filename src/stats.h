@@ -0,0 +1,52 @@
+#ifndef _KARUIWM_STATS_H
+#define _KARUIWM_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <X11/Xlib.h>
+
+/* log-linear histogram: 4 sub-buckets per power of two (~25% precision) */
+#define STATS_SUBBUCKETS 4
+#define STATS_BUCKETS (40 * STATS_SUBBUCKETS)
+
+/* wrap every Xlib call that blocks for a reply from the server */
+#define ROUNDTRIP(CALL) (stats_roundtrip(__FILE__, __LINE__), (CALL))
+
+struct stats_entry {
+	char const *kind, *name;
+	uint64_t count, total, max;
+	uint64_t requests, roundtrips;
+	int budget; /* maximum round trips per call, -1 for none */
+	uint64_t buckets[STATS_BUCKETS];
+};
+
+struct stats_timer {
+	struct stats_timer *parent;
+	struct stats_entry *entry;
+	uint64_t start, roundtrips;
+	long unsigned serial;
+};
+
+struct {
+	struct stats_entry events[LASTEvent];
+	struct stats_entry arrange;
+	struct stats_entry stalls;
+	struct stats_timer *timer;
+	uint64_t roundtrips;
+	char const *roundtrip_file;
+	int unsigned roundtrip_line;
+} stats;
+
+void stats_dump(FILE *f);
+void stats_dump_entry(FILE *f, struct stats_entry *e);
+char const *stats_event_name(int type);
+void stats_init(void);
+void stats_init_entry(struct stats_entry *e, char const *kind,
+                      char const *name);
+uint64_t stats_now(void);
+void stats_record(struct stats_entry *e, uint64_t ns);
+void stats_roundtrip(char const *file, int unsigned line);
+void stats_start(struct stats_timer *t, struct stats_entry *e);
+void stats_stop(struct stats_timer *t);
+
+#endif /* ndef _KARUIWM_STATS_H */
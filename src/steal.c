@@ -0,0 +1,99 @@
+#include "steal.h"
+#include "karuiwm.h"
+#include "desktop.h"
+#include "focus.h"
+#include "stats.h"
+#include "timer.h"
+#include "util.h"
+#include <inttypes.h>
+#include <stdint.h>
+
+/* a window that took the focus from the selected client, counted in
+ * steals.top at the same index */
+struct steal_window {
+	uint64_t refocused, deferred;
+	uint64_t last; /* stats_now() of the last steal */
+	uint64_t until; /* stats_now() until which steals are not answered */
+	uint64_t backoff; /* ns, for the next repeated steal */
+};
+
+static void refocus(void *arg);
+
+static struct {
+	struct topk top[STEAL_WINDOWS];
+	struct steal_window windows[STEAL_WINDOWS];
+	uint64_t count, refocused, deferred, activations;
+	struct timer refocus;
+} steals = { .refocus = TIMER_INIT(refocus, NULL) };
+
+static void
+refocus(void *arg)
+{
+	struct desktop *d = karuiwm.focus->selmon->seldt;
+	(void) arg;
+
+	desktop_focus_client(d, d->selcli);
+}
+
+void
+steal_activation(void)
+{
+	++steals.activations;
+}
+
+void
+steal_dump(FILE *f)
+{
+	size_t i, norder, order[STEAL_TOP];
+	struct topk *t;
+	struct steal_window *w;
+
+	(void) fprintf(f, "steal count=%"PRIu64" refocused=%"PRIu64
+	               " deferred=%"PRIu64" activations=%"PRIu64"\n",
+	               steals.count, steals.refocused, steals.deferred,
+	               steals.activations);
+	norder = topk_order(steals.top, STEAL_WINDOWS, order, STEAL_TOP);
+	for (i = 0; i < norder; ++i) {
+		t = &steals.top[order[i]];
+		w = &steals.windows[order[i]];
+		(void) fprintf(f, "steal_window %lu count=%"PRIu64
+		               " refocused=%"PRIu64" deferred=%"PRIu64
+		               " backoff_ms=%"PRIu64"\n", t->key, t->count,
+		               w->refocused, w->deferred, w->backoff / 1000000);
+	}
+}
+
+bool
+steal_record(Window win)
+{
+	bool replaced;
+	size_t i;
+	uint64_t now = stats_now();
+	struct steal_window *w;
+
+	/* an evicted window's backoff goes with it */
+	i = topk_count(steals.top, STEAL_WINDOWS, win, &replaced);
+	w = &steals.windows[i];
+	if (replaced)
+		*w = (struct steal_window) { 0 };
+	++steals.count;
+	if (w->last == 0 || now - w->last > (uint64_t) STEAL_FORGET * 1000000)
+		w->backoff = 0;
+	w->last = now;
+
+	/* while backing off, take the focus back once the backoff expires,
+	 * so a window stealing in a loop gets at most one answer per backoff */
+	if (now < w->until) {
+		++w->deferred;
+		++steals.deferred;
+		if (!steals.refocus.armed)
+			timer_arm(&steals.refocus, w->until - now);
+		return false;
+	}
+	++w->refocused;
+	++steals.refocused;
+	w->until = now + w->backoff;
+	w->backoff = w->backoff == 0 ? (uint64_t) STEAL_BACKOFF * 1000000
+	           : MIN(2 * w->backoff, (uint64_t) STEAL_BACKOFF_MAX * 1000000);
+	return true;
+}
@@ -0,0 +1,18 @@
+#ifndef _KARUIWM_STEAL_H
+#define _KARUIWM_STEAL_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <X11/Xlib.h>
+
+#define STEAL_WINDOWS 8 /* windows tracked */
+#define STEAL_TOP 3 /* windows named in the statistics */
+#define STEAL_BACKOFF 100 /* ms, first backoff after a repeated steal */
+#define STEAL_BACKOFF_MAX 10000 /* ms */
+#define STEAL_FORGET 10000 /* ms without steals until the backoff is reset */
+
+void steal_activation(void);
+void steal_dump(FILE *f);
+bool steal_record(Window win);
+
+#endif /* ndef _KARUIWM_STEAL_H */
@@ -0,0 +1,65 @@
+#include "timer.h"
+#include "list.h"
+#include "stats.h"
+
+static struct timer *timers;
+
+void
+timer_arm(struct timer *t, uint64_t delay)
+{
+	struct timer *next;
+	size_t i, n;
+
+	timer_cancel(t);
+	t->deadline = stats_now() + delay;
+	t->armed = true;
+
+	/* keep the list sorted, timers with the same deadline fire in the
+	 * order they were armed */
+	n = LIST_SIZE(timers);
+	for (i = 0, next = timers; i < n; ++i, next = next->next) {
+		if (next->deadline > t->deadline) {
+			LIST_INSERT(&timers, t, next);
+			return;
+		}
+	}
+	LIST_APPEND(&timers, t);
+}
+
+void
+timer_cancel(struct timer *t)
+{
+	if (!t->armed)
+		return;
+	LIST_REMOVE(&timers, t);
+	t->armed = false;
+}
+
+uint64_t
+timer_next(void)
+{
+	uint64_t now;
+
+	if (timers == NULL)
+		return UINT64_MAX;
+	now = stats_now();
+	return timers->deadline > now ? timers->deadline - now : 0;
+}
+
+void
+timer_run(void)
+{
+	struct timer *t;
+	uint64_t now;
+
+	if (timers == NULL)
+		return;
+
+	/* now is sampled once, a timer rearming itself fires in a later call */
+	now = stats_now();
+	while (timers != NULL && timers->deadline <= now) {
+		t = timers;
+		timer_cancel(t);
+		t->fire(t->arg);
+	}
+}
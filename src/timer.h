@@ -0,0 +1,23 @@
+#ifndef _KARUIWM_TIMER_H
+#define _KARUIWM_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_INIT(FIRE, ARG) { NULL, NULL, 0, FIRE, ARG, false }
+
+/* one-shot timer, fired from the event loop */
+struct timer {
+	struct timer *prev, *next; /* list.h, sorted by deadline */
+	uint64_t deadline; /* stats_now() */
+	void (*fire)(void *arg);
+	void *arg;
+	bool armed;
+};
+
+void timer_arm(struct timer *t, uint64_t delay);
+void timer_cancel(struct timer *t);
+uint64_t timer_next(void);
+void timer_run(void);
+
+#endif /* ndef _KARUIWM_TIMER_H */
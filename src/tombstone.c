@@ -0,0 +1,118 @@
+#include "tombstone.h"
+#include "karuiwm.h"
+#include <inttypes.h>
+#include <stdint.h>
+
+static void add(Window win);
+static size_t find(Window win);
+static Bool scan(Display *dpy, XEvent *xe, XPointer arg);
+static Window subject(XEvent *xe);
+
+/* windows whose DestroyNotify is still in the event queue */
+static struct {
+	Window wins[TOMBSTONES];
+	size_t n, evict;
+	uint64_t requests, events; /* skipped */
+} tombstones;
+
+static void
+add(Window win)
+{
+	if (find(win) < tombstones.n)
+		return;
+	if (tombstones.n < TOMBSTONES) {
+		tombstones.wins[tombstones.n++] = win;
+	} else {
+		/* full: forget one of the older entries */
+		tombstones.wins[tombstones.evict] = win;
+		tombstones.evict = (tombstones.evict + 1) % TOMBSTONES;
+	}
+}
+
+static size_t
+find(Window win)
+{
+	size_t i;
+
+	for (i = 0; i < tombstones.n && tombstones.wins[i] != win; ++i);
+	return i;
+}
+
+static Bool
+scan(Display *dpy, XEvent *xe, XPointer arg)
+{
+	(void) dpy;
+	(void) arg;
+
+	tombstone_scan_event(xe);
+	return False;
+}
+
+static Window
+subject(XEvent *xe)
+{
+	/* the window the event is about, rather than the one it was reported
+	 * on (the root window for substructure events) */
+	switch (xe->type) {
+	case ConfigureNotify:  return xe->xconfigure.window;
+	case ConfigureRequest: return xe->xconfigurerequest.window;
+	case DestroyNotify:    return xe->xdestroywindow.window;
+	case MapNotify:        return xe->xmap.window;
+	case MapRequest:       return xe->xmaprequest.window;
+	case UnmapNotify:      return xe->xunmap.window;
+	default:               return xe->xany.window;
+	}
+}
+
+bool
+tombstone_check(Window win)
+{
+	if (tombstones.n == 0 || find(win) == tombstones.n)
+		return false;
+	++tombstones.requests;
+	return true;
+}
+
+void
+tombstone_dump(FILE *f)
+{
+	(void) fprintf(f, "tombstone skipped_requests=%"PRIu64
+	               " skipped_events=%"PRIu64"\n",
+	               tombstones.requests, tombstones.events);
+}
+
+bool
+tombstone_filter(XEvent *xe)
+{
+	size_t i;
+
+	if (tombstones.n == 0)
+		return false;
+	i = find(subject(xe));
+	if (i == tombstones.n)
+		return false;
+
+	/* DestroyNotify is the last event for a window, the XID may be
+	 * reused afterwards */
+	if (xe->type == DestroyNotify) {
+		tombstones.wins[i] = tombstones.wins[--tombstones.n];
+		return false;
+	}
+	++tombstones.events;
+	return true;
+}
+
+void
+tombstone_scan(void)
+{
+	XEvent xe;
+
+	(void) XCheckIfEvent(karuiwm.dpy, &xe, scan, NULL);
+}
+
+void
+tombstone_scan_event(XEvent *xe)
+{
+	if (xe->type == DestroyNotify)
+		add(xe->xdestroywindow.window);
+}
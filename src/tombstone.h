@@ -0,0 +1,16 @@
+#ifndef _KARUIWM_TOMBSTONE_H
+#define _KARUIWM_TOMBSTONE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <X11/Xlib.h>
+
+#define TOMBSTONES 64 /* destroyed windows remembered at a time */
+
+bool tombstone_check(Window win);
+void tombstone_dump(FILE *f);
+bool tombstone_filter(XEvent *xe);
+void tombstone_scan(void);
+void tombstone_scan_event(XEvent *xe);
+
+#endif /* ndef _KARUIWM_TOMBSTONE_H */
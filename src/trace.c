@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "trace.h"
+#include "stats.h"
+#include "util.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static void write_event(struct trace_span *s);
+static void write_string(char const *str);
+
+static struct {
+	FILE *f;
+	int pid;
+	struct trace_span ring[TRACE_RINGSIZE];
+	size_t head, tail; /* tail - head = number of unwritten spans */
+	uint64_t dropped;
+	struct trace_span *named; /* named by the next lookup of its window */
+} trace;
+
+void
+trace_begin(struct trace_span *s, char const *category, char const *name)
+{
+	s->active = trace.f != NULL;
+	if (!s->active)
+		return;
+	s->category = category;
+	s->name = name;
+	s->win = None;
+	s->text[0] = '\0';
+	s->nvalues = 0;
+	s->start = stats_now();
+}
+
+void
+trace_end(struct trace_span *s)
+{
+	if (!s->active)
+		return;
+	s->duration = stats_now() - s->start;
+	if (trace.named == s)
+		trace.named = NULL;
+
+	/* full: overwrite the oldest span */
+	if (trace.tail - trace.head == TRACE_RINGSIZE) {
+		++trace.head;
+		++trace.dropped;
+	}
+	trace.ring[trace.tail % TRACE_RINGSIZE] = *s;
+	++trace.tail;
+}
+
+void
+trace_flush(void)
+{
+	if (trace.f == NULL || trace.head == trace.tail)
+		return;
+	for (; trace.head != trace.tail; ++trace.head)
+		write_event(&trace.ring[trace.head % TRACE_RINGSIZE]);
+	(void) fflush(trace.f);
+}
+
+int
+trace_init(char const *path)
+{
+	trace.f = fopen(path, "w");
+	if (trace.f == NULL) {
+		ERROR("could not open trace file %s: %s",
+		      path, strerror(errno));
+		return -1;
+	}
+	trace.pid = (int) getpid();
+	trace.head = trace.tail = 0;
+	trace.dropped = 0;
+	(void) fprintf(trace.f, "[{\"name\":\"process_name\",\"ph\":\"M\","
+	               "\"pid\":%d,\"tid\":1,\"args\":{\"name\":\"karuiwm\"}}",
+	               trace.pid);
+	return 0;
+}
+
+void
+trace_name_window(Window win, char const *name)
+{
+	struct trace_span *s = trace.named;
+
+	if (s == NULL || s->win != win)
+		return;
+	trace_text(s, name);
+	trace.named = NULL;
+}
+
+void
+trace_term(void)
+{
+	if (trace.f == NULL)
+		return;
+	trace_flush();
+	if (trace.dropped > 0)
+		WARN("trace ring buffer overflowed, %"PRIu64" spans dropped",
+		     trace.dropped);
+	(void) fprintf(trace.f, "\n]\n");
+	(void) fclose(trace.f);
+	trace.f = NULL;
+}
+
+void
+trace_text(struct trace_span *s, char const *text)
+{
+	if (!s->active)
+		return;
+	strncpy(s->text, text, TRACE_TEXTLEN - 1);
+	s->text[TRACE_TEXTLEN - 1] = '\0';
+}
+
+void
+trace_value(struct trace_span *s, char const *key, long value)
+{
+	if (!s->active || s->nvalues == TRACE_VALUES)
+		return;
+	s->keys[s->nvalues] = key;
+	s->values[s->nvalues] = value;
+	++s->nvalues;
+}
+
+void
+trace_window(struct trace_span *s, Window win)
+{
+	if (!s->active)
+		return;
+
+	/* named by the handler's own lookup of the client (see
+	 * session_locate_window()), rather than by another one here */
+	s->win = win;
+	trace.named = s;
+}
+
+static void
+write_event(struct trace_span *s)
+{
+	size_t i;
+
+	(void) fprintf(trace.f, ",\n{\"cat\":\"%s\",\"name\":\"%s\","
+	               "\"ph\":\"X\",\"pid\":%d,\"tid\":1,"
+	               "\"ts\":%"PRIu64".%03"PRIu64","
+	               "\"dur\":%"PRIu64".%03"PRIu64",\"args\":{",
+	               s->category, s->name, trace.pid,
+	               s->start / 1000, s->start % 1000,
+	               s->duration / 1000, s->duration % 1000);
+	(void) fprintf(trace.f, "\"window\":%lu", s->win);
+	if (s->text[0] != '\0') {
+		(void) fprintf(trace.f, ",\"name\":");
+		write_string(s->text);
+	}
+	for (i = 0; i < s->nvalues; ++i)
+		(void) fprintf(trace.f, ",\"%s\":%ld",
+		               s->keys[i], s->values[i]);
+	(void) fprintf(trace.f, "}}");
+}
+
+static void
+write_string(char const *str)
+{
+	char const *c;
+
+	(void) fputc('"', trace.f);
+	for (c = str; *c != '\0'; ++c) {
+		if (*c == '"' || *c == '\\')
+			(void) fprintf(trace.f, "\\%c", *c);
+		else if ((char unsigned) *c < 0x20)
+			(void) fprintf(trace.f, "\\u%04x", (int unsigned) *c);
+		else
+			(void) fputc(*c, trace.f);
+	}
+	(void) fputc('"', trace.f);
+}
@@ -0,0 +1,34 @@
+#ifndef _KARUIWM_TRACE_H
+#define _KARUIWM_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <X11/Xlib.h>
+
+#define TRACE_RINGSIZE 8192
+#define TRACE_TEXTLEN 48
+#define TRACE_VALUES 2
+
+struct trace_span {
+	bool active;
+	char const *category, *name;
+	uint64_t start, duration;
+	Window win;
+	char text[TRACE_TEXTLEN];
+	size_t nvalues;
+	char const *keys[TRACE_VALUES];
+	long values[TRACE_VALUES];
+};
+
+void trace_begin(struct trace_span *s, char const *category, char const *name);
+void trace_end(struct trace_span *s);
+void trace_flush(void);
+int trace_init(char const *path);
+void trace_name_window(Window win, char const *name);
+void trace_term(void);
+void trace_text(struct trace_span *s, char const *text);
+void trace_value(struct trace_span *s, char const *key, long value);
+void trace_window(struct trace_span *s, Window win);
+
+#endif /* ndef _KARUIWM_TRACE_H */
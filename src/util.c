@@ -1,112 +1,256 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "util.h"
 #include "karuiwm.h"
+#include "stats.h"
+#include <inttypes.h>
 #include <stdarg.h>
-#include <time.h>
 #include <string.h>
 
-#define ESC "\033"
-#define ESC_BOLD    ESC"[1m"
-#define ESC_BLACK   ESC"[30m"
-#define ESC_RED     ESC"[31m"
-#define ESC_GREEN   ESC"[32m"
-#define ESC_YELLOW  ESC"[33m"
-#define ESC_BLUE    ESC"[34m"
-#define ESC_MAGENTA ESC"[35m"
-#define ESC_CYAN    ESC"[36m"
-#define ESC_WHITE   ESC"[37m"
-#define ESC_RESET   ESC"[0m"
+/* direct-mapped cache of context string pointers */
+#define ALLOC_CACHE 64
+
+/* prepended to every allocation; the union keeps the payload aligned */
+union alloc_header {
+	struct {
+		struct alloc_context *ctx;
+		size_t size;
+	} a;
+	long double ld;
+	intmax_t im;
+	void *p;
+};
+
+/* functions */
+static void *alloc_attach(union alloc_header *h, size_t size,
+                          char const *context);
+static void alloc_detach(union alloc_header *h);
+static struct alloc_context *alloc_lookup(char const *name);
 
 /* variables */
-static enum log_level log_level;
+static struct slab *slabs;
+static struct {
+	struct alloc_context *contexts;
+	struct {
+		char const *name;
+		struct alloc_context *ctx;
+	} cache[ALLOC_CACHE];
+	uint64_t total;
+	uint64_t dumped; /* time of the last dump */
+} alloc;
 
 /* implementation */
+static void *
+alloc_attach(union alloc_header *h, size_t size, char const *context)
+{
+	struct alloc_context *ctx = alloc_lookup(context);
+
+	h->a.ctx = ctx;
+	h->a.size = size;
+	ctx->bytes += size;
+	++ctx->count;
+	++ctx->allocs;
+	ctx->peak = MAX(ctx->peak, ctx->bytes);
+	++alloc.total;
+	return h + 1;
+}
+
+static void
+alloc_detach(union alloc_header *h)
+{
+	h->a.ctx->bytes -= h->a.size;
+	--h->a.ctx->count;
+}
+
 void
-print(FILE *f, enum log_level level, char const *filename, int unsigned line,
-      char const *format, ...)
+alloc_dump(FILE *f)
 {
-	va_list args;
-	time_t rawtime;
-	struct tm *date;
-	char const *col;
+	struct alloc_context *ctx;
+	uint64_t now = stats_now();
+	double secs = (double) (now - alloc.dumped) / 1000000000.0;
 
-	if (level > log_level)
-		return;
+	for (ctx = alloc.contexts; ctx != NULL; ctx = ctx->next) {
+		(void) fprintf(f, "alloc %s bytes=%zu count=%zu peak=%zu "
+		               "allocs=%"PRIu64" rate=%.1f\n", ctx->name,
+		               ctx->bytes, ctx->count, ctx->peak, ctx->allocs,
+		               secs > 0 ? (double) (ctx->allocs - ctx->dumped)
+		                          / secs : 0.0);
+		ctx->dumped = ctx->allocs;
+	}
+	alloc.dumped = now;
+}
+
+size_t
+alloc_leaks(void)
+{
+	size_t n = 0;
+	struct alloc_context *ctx;
+	struct slab *s;
 
-	/* application name & timestamp */
-	rawtime = time(NULL);
-	date = localtime(&rawtime);
-	(void) fprintf(f, "%s %04d-%02d-%02dT%02d:%02d:%02d ",
-	               karuiwm.env.APPNAME,
-	               date->tm_year+1900, date->tm_mon + 1, date->tm_mday,
-	               date->tm_hour, date->tm_min, date->tm_sec);
-
-	/* log level */
-	switch (level) {
-	case LOG_FATAL : col = ESC_BOLD ESC_RED    "FATAL" ESC_RESET " "; break;
-	case LOG_ERROR : col =          ESC_RED    "ERROR" ESC_RESET " "; break;
-	case LOG_WARN  : col =          ESC_YELLOW "WARN"  ESC_RESET " "; break;
-	case LOG_NOTICE: col =          ESC_CYAN   "NOTICE"ESC_RESET " "; break;
-	case LOG_EVENT : col =          ESC_MAGENTA"EVENT" ESC_RESET " "; break;
-	case LOG_DEBUG : col =          ESC_BLUE   "DEBUG" ESC_RESET " "; break;
-	default        : col =                                        "";
+	/* slab chunks are never returned, check their objects instead */
+	for (ctx = alloc.contexts; ctx != NULL; ctx = ctx->next) {
+		if (ctx->count == 0 || strcmp(ctx->name, SLAB_CONTEXT) == 0)
+			continue;
+		WARN("%zu bytes in %zu objects still allocated for %s",
+		     ctx->bytes, ctx->count, ctx->name);
+		n += ctx->count;
 	}
-	(void) fprintf(f, "%s", col);
+	for (s = slabs; s != NULL; s = s->next) {
+		if (s->live == 0)
+			continue;
+		WARN("%zu objects still allocated from the %s slab",
+		     s->live, s->name);
+		n += s->live;
+	}
+	return n;
+}
 
-	/* message */
-	va_start(args, format);
-	(void) vfprintf(f, format, args);
-	va_end(args);
+static struct alloc_context *
+alloc_lookup(char const *name)
+{
+	size_t slot = ((uintptr_t) name >> 3) % ALLOC_CACHE;
+	struct alloc_context *ctx;
 
-	/* position */
-	if (level >= LOG_EVENT)
-		(void) fprintf(f, " \033[32m%s:%u\033[0m", filename, line);
+	if (alloc.cache[slot].name == name)
+		return alloc.cache[slot].ctx;
 
-	(void) fprintf(f, "\n");
-	(void) fflush(f);
+	/* the same context may be spelled out in several places */
+	for (ctx = alloc.contexts; ctx != NULL; ctx = ctx->next)
+		if (strcmp(ctx->name, name) == 0)
+			break;
+	if (ctx == NULL) {
+		ctx = calloc(1, sizeof(struct alloc_context));
+		if (ctx == NULL)
+			FATAL("could not allocate statistics for %s", name);
+		ctx->name = name;
+		ctx->next = alloc.contexts;
+		alloc.contexts = ctx;
+		if (alloc.dumped == 0)
+			alloc.dumped = stats_now();
+	}
+	alloc.cache[slot].name = name;
+	alloc.cache[slot].ctx = ctx;
+	return ctx;
 }
 
-void
-set_log_level(enum log_level level)
+uint64_t
+alloc_total(void)
 {
-	log_level = level;
+	return alloc.total;
 }
 
+
 void *
 scalloc(size_t nmemb, size_t size, char const *context)
 {
-	void *ptr = calloc(nmemb, size);
-	if (ptr == NULL && nmemb > 0)
+	union alloc_header *h;
+
+	if (nmemb == 0)
+		return NULL;
+	if (size > (SIZE_MAX - sizeof(union alloc_header)) / nmemb)
+		FATAL("could not allocate %zu*%zu bytes for %s",
+		      nmemb, size, context);
+	h = calloc(1, sizeof(union alloc_header) + nmemb * size);
+	if (h == NULL)
 		FATAL("could not allocate %zu bytes for %s", nmemb * size,
 		      context);
-	return ptr;
+	return alloc_attach(h, nmemb * size, context);
 }
 
 void *
 smalloc(size_t size, char const *context)
 {
-	void *ptr = malloc(size);
-	if (ptr == NULL)
+	union alloc_header *h = NULL;
+
+	if (size <= SIZE_MAX - sizeof(union alloc_header))
+		h = malloc(sizeof(union alloc_header) + size);
+	if (h == NULL)
 		FATAL("could not allocate %zu bytes for %s", size, context);
-	return ptr;
+	return alloc_attach(h, size, context);
 }
 
 void *
 srealloc(void *ptr, size_t size, char const *context)
 {
+	union alloc_header *h;
+
 	if (size == 0) {
-		free(ptr);
+		sfree(ptr);
 		return NULL;
 	}
-	ptr = realloc(ptr, size);
 	if (ptr == NULL)
+		return smalloc(size, context);
+	h = (union alloc_header *) ptr - 1;
+	alloc_detach(h);
+	if (size <= SIZE_MAX - sizeof(union alloc_header))
+		h = realloc(h, sizeof(union alloc_header) + size);
+	else
+		h = NULL;
+	if (h == NULL)
 		FATAL("could not allocate %zu bytes for %s", size, context);
-	return ptr;
+	return alloc_attach(h, size, context);
 }
 
 void
 sfree(void *ptr)
 {
-	free(ptr);
+	union alloc_header *h;
+
+	if (ptr == NULL)
+		return;
+	h = (union alloc_header *) ptr - 1;
+	alloc_detach(h);
+	free(h);
+}
+
+void *
+slab_alloc(struct slab *s)
+{
+	size_t i, size = MAX(s->size, sizeof(void *));
+	char *chunk;
+	void *obj;
+
+	if (!s->registered) {
+		s->next = slabs;
+		slabs = s;
+		s->registered = true;
+	}
+	if (s->free == NULL) {
+		/* thread a new chunk onto the free list */
+		chunk = smalloc(size * SLAB_CHUNK, SLAB_CONTEXT);
+		for (i = 0; i < SLAB_CHUNK; ++i)
+			*(void **) (void *) (chunk + i * size) =
+				i + 1 < SLAB_CHUNK ? chunk + (i + 1) * size
+				                   : NULL;
+		s->free = chunk;
+		++s->nchunks;
+	}
+	obj = s->free;
+	s->free = *(void **) obj;
+	++s->live;
+	s->peak = MAX(s->peak, s->live);
+	return obj;
+}
+
+void
+slab_dump(FILE *f)
+{
+	struct slab *s;
+
+	for (s = slabs; s != NULL; s = s->next)
+		(void) fprintf(f, "slab %s size=%zu live=%zu peak=%zu "
+		               "chunks=%zu\n", s->name, s->size, s->live,
+		               s->peak, s->nchunks);
+}
+
+void
+slab_free(struct slab *s, void *ptr)
+{
+	if (ptr == NULL)
+		return;
+	*(void **) ptr = s->free;
+	s->free = ptr;
+	--s->live;
 }
 
 char *
@@ -137,6 +281,53 @@ strdupf(char const *format, ...)
 	return dst;
 }
 
+size_t
+topk_count(struct topk *t, size_t n, long unsigned key, bool *replaced)
+{
+	size_t i, min = 0;
+
+	/* space-saving: the least counted key makes room for a new one, so
+	 * frequent keys are kept with an upper bound on their count */
+	for (i = 0; i < n; ++i) {
+		if (t[i].key == key && t[i].count > 0) {
+			++t[i].count;
+			if (replaced != NULL)
+				*replaced = false;
+			return i;
+		}
+		if (t[i].count < t[min].count)
+			min = i;
+	}
+	t[min].key = key;
+	++t[min].count;
+	if (replaced != NULL)
+		*replaced = true;
+	return min;
+}
+
+size_t
+topk_order(struct topk const *t, size_t n, size_t *order, size_t k)
+{
+	size_t i, j, best, found;
+
+	/* the most counted keys first, earlier ones on ties */
+	for (found = 0; found < k; ++found) {
+		best = n;
+		for (j = 0; j < n; ++j) {
+			if (t[j].count == 0
+			|| (best < n && t[j].count <= t[best].count))
+				continue;
+			for (i = 0; i < found && order[i] != j; ++i);
+			if (i == found)
+				best = j;
+		}
+		if (best == n)
+			break;
+		order[found] = best;
+	}
+	return found;
+}
+
 int
 vstrlenf(char const *format, va_list ap)
 {
@@ -4,35 +4,108 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 
-#define DEBUG(...)   print(stderr,LOG_DEBUG,  __FILE__,__LINE__,__VA_ARGS__)
-#define EVENT(...)   print(stderr,LOG_EVENT,  __FILE__,__LINE__,__VA_ARGS__)
-#define VERBOSE(...) print(stdout,LOG_VERBOSE,__FILE__,__LINE__,__VA_ARGS__)
-#define NORMAL(...)  print(stdout,LOG_NORMAL, __FILE__,__LINE__,__VA_ARGS__)
-#define NOTICE(...)  print(stdout,LOG_NOTICE, __FILE__,__LINE__,__VA_ARGS__)
-#define WARN(...)    print(stderr,LOG_WARN,   __FILE__,__LINE__,__VA_ARGS__)
-#define ERROR(...)   print(stderr,LOG_ERROR,  __FILE__,__LINE__,__VA_ARGS__)
+/* least severe level compiled in, calls above it are eliminated */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_DEBUG
+#endif
+
+#define LOG(F, L, ...) do { if ((L) <= LOG_MIN_LEVEL) \
+                            print(F, L, __FILE__, __LINE__, __VA_ARGS__); \
+                       } while (0)
+#define DEBUG(...)   LOG(stderr, LOG_DEBUG,   __VA_ARGS__)
+#define EVENT(...)   LOG(stderr, LOG_EVENT,   __VA_ARGS__)
+#define VERBOSE(...) LOG(stdout, LOG_VERBOSE, __VA_ARGS__)
+#define NORMAL(...)  LOG(stdout, LOG_NORMAL,  __VA_ARGS__)
+#define NOTICE(...)  LOG(stdout, LOG_NOTICE,  __VA_ARGS__)
+#define WARN(...)    LOG(stderr, LOG_WARN,    __VA_ARGS__)
+#define ERROR(...)   LOG(stderr, LOG_ERROR,   __VA_ARGS__)
+/* like WARN, but at most once per LOG_PERIOD and call site, the rest is counted
+ * and summarised; event loop thread only */
+#define WARN_LIMIT(...) do { static struct log_site _site = LOG_SITE_INIT; \
+                             if (log_limit(&_site)) \
+                                 WARN(__VA_ARGS__); \
+                        } while (0)
+#define LOG_SITE_INIT { NULL, __FILE__, __LINE__, 0, 0, false }
+#define LOG_PERIOD 10 /* seconds */
 #define FATAL(...) { print(stderr,LOG_FATAL,  __FILE__,__LINE__,__VA_ARGS__); \
                      exit(EXIT_FAILURE); }
 
+/* allocation context for slab chunks, see slab_dump() for their contents */
+#define SLAB_CONTEXT "slab"
+
+/* objects per slab chunk */
+#define SLAB_CHUNK 64
+#define SLAB_INIT(NAME, TYPE) { NULL, NAME, sizeof(TYPE), NULL, 0, 0, 0, false }
+
 /* enumerations */
 enum log_level { LOG_FATAL, LOG_ERROR, LOG_WARN, LOG_NOTICE, LOG_NORMAL,
                  LOG_VERBOSE, LOG_EVENT, LOG_DEBUG };
 
-/* output */
+/* call site of WARN_LIMIT() */
+struct log_site {
+	struct log_site *next; /* all sites used so far, for log_dump() */
+	char const *filename;
+	int unsigned line;
+	uint64_t count; /* in total */
+	uint64_t period; /* in the current period */
+	bool registered;
+};
+
+/* allocation statistics per context string passed to smalloc() and friends */
+struct alloc_context {
+	struct alloc_context *next;
+	char const *name;
+	size_t bytes, count, peak; /* live bytes and objects, peak bytes */
+	uint64_t allocs, dumped; /* allocations in total and at last dump */
+};
+
+/* free-list allocator for fixed-size objects; chunks are never returned */
+struct slab {
+	struct slab *next; /* all slabs in use, for slab_dump() */
+	char const *name;
+	size_t size;
+	void *free;
+	size_t live, peak, nchunks;
+	bool registered;
+};
+
+/* approximate counter of the most frequent keys (e.g. windows), see
+ * topk_count() */
+struct topk {
+	long unsigned key;
+	uint64_t count;
+};
+
+/* output, see log.c; print() may be called from any thread, the rest from the
+ * event loop only */
 void print(FILE *f, enum log_level level, char const *filename,
            int unsigned line, char const *format, ...)
            __attribute__((format(printf,5,6)));
+void log_dump(FILE *f);
+bool log_limit(struct log_site *site);
 void set_log_level(enum log_level level);
 
 /* memory allocation */
+void alloc_dump(FILE *f);
+size_t alloc_leaks(void);
+uint64_t alloc_total(void);
 void *scalloc(size_t nmemb, size_t size, char const *ctx);
 void *smalloc(size_t size, char const *context);
 void *srealloc(void *ptr, size_t size, char const *ctx);
 void sfree(void *ptr);
+void *slab_alloc(struct slab *s);
+void slab_dump(FILE *f);
+void slab_free(struct slab *s, void *ptr);
 
 /* strings */
 char *strdupf(char const *format, ...);
 int vstrlenf(char const *format, va_list ap);
 
+/* most frequent keys */
+size_t topk_count(struct topk *t, size_t n, long unsigned key, bool *replaced);
+size_t topk_order(struct topk const *t, size_t n, size_t *order, size_t k);
+
 #endif /* ndef _KARUIWM_UTIL_H */
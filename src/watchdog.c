@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "watchdog.h"
+#include "stats.h"
+#include "util.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+static void *watch(void *arg);
+
+/* fields accessed by both threads are only accessed through __atomic */
+static struct {
+	bool running;
+	uint64_t threshold; /* ns, 0 if disabled */
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	uint64_t since; /* start of the current dispatch, 0 if idle */
+	uint64_t seq;   /* current dispatch */
+	int type;
+	Window win;
+} watchdog;
+
+void
+watchdog_enter(int type, Window win)
+{
+	if (watchdog.threshold == 0)
+		return;
+	__atomic_store_n(&watchdog.type, type, __ATOMIC_RELAXED);
+	__atomic_store_n(&watchdog.win, win, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&watchdog.seq, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&watchdog.since, stats_now(), __ATOMIC_RELEASE);
+}
+
+int
+watchdog_init(int unsigned threshold)
+{
+	int err;
+
+	watchdog.threshold = (uint64_t) threshold * 1000000;
+	if (watchdog.threshold == 0)
+		return 0;
+	watchdog.since = watchdog.seq = 0;
+	watchdog.running = true;
+	(void) pthread_mutex_init(&watchdog.mutex, NULL);
+	(void) pthread_cond_init(&watchdog.cond, NULL);
+	err = pthread_create(&watchdog.thread, NULL, watch, NULL);
+	if (err != 0) {
+		ERROR("could not start watchdog: %s", strerror(err));
+		watchdog.threshold = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void
+watchdog_leave(void)
+{
+	uint64_t since, duration;
+
+	if (watchdog.threshold == 0)
+		return;
+	since = __atomic_exchange_n(&watchdog.since, 0, __ATOMIC_ACQ_REL);
+	if (since == 0)
+		return;
+	duration = stats_now() - since;
+	if (duration > watchdog.threshold) {
+		stats_record(&stats.stalls, duration);
+		NOTICE("event loop stall ended after %"PRIu64" ms "
+		       "(%s, window %lu)", duration / 1000000,
+		       stats_event_name(watchdog.type), watchdog.win);
+	}
+}
+
+void
+watchdog_term(void)
+{
+	if (watchdog.threshold == 0)
+		return;
+	(void) pthread_mutex_lock(&watchdog.mutex);
+	__atomic_store_n(&watchdog.running, false, __ATOMIC_RELAXED);
+	(void) pthread_cond_signal(&watchdog.cond);
+	(void) pthread_mutex_unlock(&watchdog.mutex);
+	(void) pthread_join(watchdog.thread, NULL);
+	(void) pthread_cond_destroy(&watchdog.cond);
+	(void) pthread_mutex_destroy(&watchdog.mutex);
+	watchdog.threshold = 0;
+}
+
+static void *
+watch(void *arg)
+{
+	struct timespec ts;
+	uint64_t since, seq, reported = 0, interval = watchdog.threshold / 2;
+	char const *file;
+	(void) arg;
+
+	(void) pthread_mutex_lock(&watchdog.mutex);
+	while (__atomic_load_n(&watchdog.running, __ATOMIC_RELAXED)) {
+		(void) clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += (time_t) (interval / 1000000000);
+		ts.tv_nsec += (long) (interval % 1000000000);
+		if (ts.tv_nsec >= 1000000000) {
+			++ts.tv_sec;
+			ts.tv_nsec -= 1000000000;
+		}
+		(void) pthread_cond_timedwait(&watchdog.cond, &watchdog.mutex,
+		                              &ts);
+
+		/* report each stalled dispatch once */
+		since = __atomic_load_n(&watchdog.since, __ATOMIC_ACQUIRE);
+		seq = __atomic_load_n(&watchdog.seq, __ATOMIC_RELAXED);
+		if (since == 0 || seq == reported
+		|| stats_now() - since < watchdog.threshold)
+			continue;
+		reported = seq;
+		file = __atomic_load_n(&stats.roundtrip_file, __ATOMIC_RELAXED);
+
+		/* logging from this thread relies on the multi-producer
+		 * message queue of log.c; WARN_LIMIT is not safe here */
+		WARN("event loop stalled for %"PRIu64" ms in handler for %s "
+		     "(window %lu), last round trip at %s:%u",
+		     (stats_now() - since) / 1000000,
+		     stats_event_name(__atomic_load_n(&watchdog.type,
+		                                      __ATOMIC_RELAXED)),
+		     __atomic_load_n(&watchdog.win, __ATOMIC_RELAXED),
+		     file == NULL ? "(none)" : file,
+		     __atomic_load_n(&stats.roundtrip_line, __ATOMIC_RELAXED));
+	}
+	(void) pthread_mutex_unlock(&watchdog.mutex);
+	return NULL;
+}
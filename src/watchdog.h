@@ -0,0 +1,11 @@
+#ifndef _KARUIWM_WATCHDOG_H
+#define _KARUIWM_WATCHDOG_H
+
+#include <X11/Xlib.h>
+
+void watchdog_enter(int type, Window win);
+int watchdog_init(int unsigned threshold);
+void watchdog_leave(void);
+void watchdog_term(void);
+
+#endif /* ndef _KARUIWM_WATCHDOG_H */
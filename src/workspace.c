@@ -1,14 +1,114 @@
 #include "workspace.h"
 #include "util.h"
 #include "list.h"
-#include <string.h>
+#include <stdint.h>
+
+static int compare_slots(int x1, int y1, int x2, int y2);
+static size_t grid_hash(struct workspace *ws, int posx, int posy);
+static void grid_insert(struct workspace *ws, struct desktop *d);
+static void grid_remove(struct workspace *ws, struct desktop *d);
+static void grid_resize(struct workspace *ws, size_t size);
+static void next_slot(int *posx, int *posy);
+
+static int
+compare_slots(int x1, int y1, int x2, int y2)
+{
+	int r1 = MAX(abs(x1), abs(y1)), r2 = MAX(abs(x2), abs(y2));
+
+	/* order in which free slots are handed out, see next_slot() */
+	if (r1 != r2)
+		return r1 < r2 ? -1 : 1;
+	if (x1 != x2)
+		return x1 < x2 ? -1 : 1;
+	return y1 < y2 ? -1 : y1 > y2;
+}
+
+static size_t
+grid_hash(struct workspace *ws, int posx, int posy)
+{
+	uint32_t h = (uint32_t) posx * 73856093u ^ (uint32_t) posy * 19349663u;
+
+	return (size_t) h & (ws->gridsize - 1);
+}
+
+static void
+grid_insert(struct workspace *ws, struct desktop *d)
+{
+	size_t h;
+
+	if (ws->nd > ws->gridsize)
+		grid_resize(ws, 2 * ws->gridsize);
+	h = grid_hash(ws, d->posx, d->posy);
+	d->gridnext = ws->grid[h];
+	ws->grid[h] = d;
+}
+
+static void
+grid_remove(struct workspace *ws, struct desktop *d)
+{
+	struct desktop **it;
+
+	for (it = &ws->grid[grid_hash(ws, d->posx, d->posy)]; *it != d;
+	     it = &(*it)->gridnext);
+	*it = d->gridnext;
+	d->gridnext = NULL;
+}
+
+static void
+grid_resize(struct workspace *ws, size_t size)
+{
+	struct desktop **old = ws->grid, *d;
+	size_t i, oldsize = ws->gridsize;
+
+	ws->grid = scalloc(size, sizeof(struct desktop *), "desktop grid");
+	ws->gridsize = size;
+	for (i = 0; i < oldsize; ++i) {
+		while (old[i] != NULL) {
+			d = old[i];
+			old[i] = d->gridnext;
+			grid_insert(ws, d);
+		}
+	}
+	sfree(old);
+}
+
+static void
+next_slot(int *posx, int *posy)
+{
+	int r = MAX(abs(*posx), abs(*posy));
+
+	/* walk the square rings around (0, 0) outwards, each column by column
+	 * and top to bottom; inner columns only have their ends on the ring */
+	if (r > 0 && *posy < r && (*posx == -r || *posx == r)) {
+		++*posy;
+	} else if (r > 0 && *posy == -r) {
+		*posy = r;
+	} else if (*posx < r) {
+		++*posx;
+		*posy = -r;
+	} else {
+		*posx = *posy = -(r + 1);
+	}
+}
 
 void
 workspace_attach_desktop(struct workspace *ws, struct desktop *d)
 {
-	workspace_locate_free_slot(ws, &d->posx, &d->posy);
+	int posx, posy;
+
+	workspace_locate_free_slot(ws, &posx, &posy);
+	workspace_attach_desktop_at(ws, d, posx, posy);
+}
+
+void
+workspace_attach_desktop_at(struct workspace *ws, struct desktop *d,
+                            int posx, int posy)
+{
+	d->posx = posx;
+	d->posy = posy;
 	LIST_APPEND(&ws->desktops, d);
 	++ws->nd;
+	grid_insert(ws, d);
 	d->workspace = ws;
 }
 
@@ -22,23 +122,32 @@ workspace_delete(struct workspace *ws)
 		workspace_detach_desktop(ws, d);
 		desktop_delete(d);
 	}
-	free(ws);
+	sfree(ws->grid);
+	sfree(ws->name);
+	sfree(ws);
 }
 
 void
 workspace_detach_desktop(struct workspace *ws, struct desktop *d)
 {
+	grid_remove(ws, d);
 	LIST_REMOVE(&ws->desktops, d);
 	--ws->nd;
+
+	/* the slot becomes free again */
+	if (compare_slots(d->posx, d->posy, ws->freex, ws->freey) < 0) {
+		ws->freex = d->posx;
+		ws->freey = d->posy;
+	}
 }
 
 struct desktop *
 workspace_locate_desktop(struct workspace *ws, int posx, int posy)
 {
-	int unsigned i;
 	struct desktop *d;
 
-	for (i = 0, d = ws->desktops; i < ws->nd; ++i, d = d->next)
+	for (d = ws->grid[grid_hash(ws, posx, posy)]; d != NULL;
+	     d = d->gridnext)
 		if (d->posx == posx && d->posy == posy)
 			return d;
 	return NULL;
@@ -47,14 +156,11 @@ workspace_locate_desktop(struct workspace *ws, int posx, int posy)
 void
 workspace_locate_free_slot(struct workspace *ws, int *posx, int *posy)
 {
-	int size;
-
-	/* TODO ugly as hell and inefficient way for searching empty spot */
-	for (size = 0;; ++size)
-		for (*posx = -size; *posx <= size; ++*posx)
-			for (*posy = -size; *posy <= size; ++*posy)
-				if (workspace_locate_desktop(ws, *posx, *posy) == NULL)
-					return;
+	/* each slot is skipped at most once until one before it is freed */
+	while (workspace_locate_desktop(ws, ws->freex, ws->freey) != NULL)
+		next_slot(&ws->freex, &ws->freey);
+	*posx = ws->freex;
+	*posy = ws->freey;
 }
 
 int
@@ -77,10 +183,13 @@ workspace_new(char const *name)
 
 	/* create workspace */
 	ws = smalloc(sizeof(struct workspace), "workspace");
-	strncpy(ws->name, name, WORKSPACE_NAMELEN);
-	ws->name[WORKSPACE_NAMELEN - 1] = '\0';
+	ws->name = strdupf("%s", name);
 	ws->nd = 0;
 	ws->desktops = NULL;
+	ws->grid = scalloc(WORKSPACE_GRIDSIZE, sizeof(struct desktop *),
+	                   "desktop grid");
+	ws->gridsize = WORKSPACE_GRIDSIZE;
+	ws->freex = ws->freey = 0;
 
 	/* initial desktop */
 	d = desktop_new();
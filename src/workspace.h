@@ -4,16 +4,22 @@
 #include "desktop.h"
 #include "karuiwm.h"
 
-#define WORKSPACE_NAMELEN 512
+/* initial number of hash buckets for the desktop grid, a power of 2 */
+#define WORKSPACE_GRIDSIZE 16
 
 struct workspace {
 	struct workspace *prev, *next; /* list.h */
 	size_t nd;
 	struct desktop *desktops;
-	char name[WORKSPACE_NAMELEN];
+	char *name;
+	struct desktop **grid; /* desktops hashed by position */
+	size_t gridsize;
+	int freex, freey; /* all slots before this one are taken */
 };
 
 void workspace_attach_desktop(struct workspace *ws, struct desktop *d);
+void workspace_attach_desktop_at(struct workspace *ws, struct desktop *d,
+                                 int posx, int posy);
 void workspace_delete(struct workspace *ws);
 void workspace_detach_desktop(struct workspace *ws, struct desktop *d);
 struct desktop *workspace_locate_desktop(struct workspace *ws,
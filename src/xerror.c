@@ -0,0 +1,135 @@
+#include "xerror.h"
+#include "karuiwm.h"
+#include "timer.h"
+#include "util.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* X errors of the same code after the same request */
+struct xerror_kind {
+	struct xerror_kind *next;
+	char unsigned error, request;
+	uint64_t count; /* in total */
+	uint64_t period; /* in the current period */
+	struct topk windows[XERROR_WINDOWS];
+};
+
+static char const *error_name(struct xerror_kind *k, char *buf, size_t len);
+static char const *request_name(struct xerror_kind *k, char *buf, size_t len);
+static void summarise(void *arg);
+static void top_windows(struct xerror_kind *k, char *buf, size_t len);
+
+static struct xerror_kind *kinds;
+static struct timer period = TIMER_INIT(summarise, NULL);
+
+/* core protocol errors, to avoid a database lookup per error */
+static char const *const errors[] = {
+	[BadRequest] = "BadRequest", [BadValue] = "BadValue",
+	[BadWindow] = "BadWindow", [BadPixmap] = "BadPixmap",
+	[BadAtom] = "BadAtom", [BadCursor] = "BadCursor",
+	[BadFont] = "BadFont", [BadMatch] = "BadMatch",
+	[BadDrawable] = "BadDrawable", [BadAccess] = "BadAccess",
+	[BadAlloc] = "BadAlloc", [BadColor] = "BadColor", [BadGC] = "BadGC",
+	[BadIDChoice] = "BadIDChoice", [BadName] = "BadName",
+	[BadLength] = "BadLength", [BadImplementation] = "BadImplementation",
+};
+
+static char const *
+error_name(struct xerror_kind *k, char *buf, size_t len)
+{
+	if (k->error < sizeof(errors) / sizeof(errors[0])
+	&& errors[k->error] != NULL)
+		return errors[k->error];
+	XGetErrorText(karuiwm.dpy, (int) k->error, buf, (int) len);
+	return buf;
+}
+
+static char const *
+request_name(struct xerror_kind *k, char *buf, size_t len)
+{
+	char code[8];
+
+	(void) snprintf(code, sizeof(code), "%u", k->request);
+	XGetErrorDatabaseText(karuiwm.dpy, "XRequest", code, "", buf,
+	                      (int) len);
+	if (buf[0] == '\0')
+		(void) snprintf(buf, len, "request_%u", k->request);
+	return buf;
+}
+
+void
+xerror_dump(FILE *f)
+{
+	struct xerror_kind *k;
+	char ebuf[128], rbuf[128];
+
+	for (k = kinds; k != NULL; k = k->next)
+		(void) fprintf(f, "xerror %s %s count=%"PRIu64"\n",
+		               error_name(k, ebuf, sizeof(ebuf)),
+		               request_name(k, rbuf, sizeof(rbuf)), k->count);
+}
+
+void
+xerror_record(XErrorEvent *ee)
+{
+	struct xerror_kind *k;
+	char ebuf[128], rbuf[128];
+
+	for (k = kinds; k != NULL; k = k->next)
+		if (k->error == ee->error_code
+		&& k->request == ee->request_code)
+			break;
+	if (k == NULL) {
+		k = scalloc(1, sizeof(struct xerror_kind), "X error kind");
+		k->error = ee->error_code;
+		k->request = ee->request_code;
+		k->next = kinds;
+		kinds = k;
+	}
+	++k->count;
+	(void) topk_count(k->windows, XERROR_WINDOWS, ee->resourceid, NULL);
+
+	/* log the first error of each period, summarise the rest */
+	if (k->period++ > 0)
+		return;
+	ERROR("%s after %s on window %lu", error_name(k, ebuf, sizeof(ebuf)),
+	      request_name(k, rbuf, sizeof(rbuf)), ee->resourceid);
+	if (!period.armed)
+		timer_arm(&period, (uint64_t) LOG_PERIOD * 1000000000);
+}
+
+static void
+summarise(void *arg)
+{
+	struct xerror_kind *k;
+	char ebuf[128], rbuf[128], top[XERROR_TOP * 64];
+	(void) arg;
+
+	for (k = kinds; k != NULL; k = k->next) {
+		if (k->period > 1) {
+			top_windows(k, top, sizeof(top));
+			ERROR("%s after %s x%"PRIu64" in the last %ds, "
+			      "top windows: %s",
+			      error_name(k, ebuf, sizeof(ebuf)),
+			      request_name(k, rbuf, sizeof(rbuf)),
+			      k->period, LOG_PERIOD, top);
+		}
+		k->period = 0;
+		memset(k->windows, 0, sizeof(k->windows));
+	}
+}
+
+static void
+top_windows(struct xerror_kind *k, char *buf, size_t len)
+{
+	size_t i, n = 0, norder, order[XERROR_TOP];
+
+	buf[0] = '\0';
+	norder = topk_order(k->windows, XERROR_WINDOWS, order, XERROR_TOP);
+	for (i = 0; i < norder && n < len; ++i)
+		n += (size_t) snprintf(buf + n, len - n, "%s%lu (%"PRIu64")",
+		                       i > 0 ? ", " : "",
+		                       k->windows[order[i]].key,
+		                       k->windows[order[i]].count);
+}
@@ -0,0 +1,13 @@
+#ifndef _KARUIWM_XERROR_H
+#define _KARUIWM_XERROR_H
+
+#include <stdio.h>
+#include <X11/Xlib.h>
+
+#define XERROR_WINDOWS 8 /* windows tracked per kind of error */
+#define XERROR_TOP 3 /* windows named in summaries */
+
+void xerror_dump(FILE *f);
+void xerror_record(XErrorEvent *ee);
+
+#endif /* ndef _KARUIWM_XERROR_H */
@@ -8,12 +8,15 @@
 #include <X11/Xlib.h>
 #include <errno.h>
 
+static struct slab xresource_slab = SLAB_INIT("X resource",
+                                              struct xresource);
+
 void
 xresource_delete(struct xresource *xr)
 {
 	sfree(xr->key);
 	sfree(xr->value);
-	sfree(xr);
+	slab_free(&xresource_slab, xr);
 }
 
 struct xresource *
@@ -57,7 +60,7 @@ xresource_new(char const *prefix, char const *line)
 	value[length] = '\0';
 
 	/* X resource */
-	xr = smalloc(sizeof(struct xresource), "X resource");
+	xr = slab_alloc(&xresource_slab);
 	xr->key = key;
 	xr->value = value;
 